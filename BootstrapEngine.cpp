@@ -0,0 +1,235 @@
+/**************************************************************************
+BootstrapEngine.cpp - statistics of isolates resampled with replacement
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. All sums are of whole numbers & so are exact, as they are
+  when the drawn isolates are copied out & the statistics worked out in
+  the usual way.
+
+Changes:
+- The number of pairs comes from the weights, not the rows, so that the
+  rows can be distinct genotypes standing for several isolates.
+- The distances are held as narrow as they will go (see PairDistArray.h).
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "BootstrapEngine.h"
+
+#include <cassert>
+
+
+// *** MAIN BODY *********************************************************/
+
+// *** LIFECYCLE *********************************************************/
+
+BootstrapEngine::BootstrapEngine
+(const PairDistArray& iDists, UInt iNumIso, UInt iNumLoci)
+	: mNumIso (iNumIso), mNumLoci (iNumLoci), mDistArray (&iDists),
+	mClasses (iNumIso * iNumLoci, 0), mNumClasses (iNumLoci, 0),
+	mDists (iNumLoci)
+{
+	assert (mDistArray->size() == (ulong (mNumIso) * (mNumIso - 1)) / 2);
+}
+
+
+// *** SERVICES **********************************************************/
+
+// SET LOCUS
+// The class (allele or diplotype) of every isolate at a locus, & the
+// distances between classes as a flattened square.
+void BootstrapEngine::SetLocus (UInt iLocus, const vector<UInt>& iClasses,
+	UInt iNumClasses, const vector<uchar>& iDists)
+{
+	assert (iLocus < mNumLoci);
+	assert (iClasses.size() == mNumIso);
+	assert (iDists.size() == iNumClasses * iNumClasses);
+
+	for (UInt i = 0; i < mNumIso; i++)
+		mClasses[(iLocus * mNumIso) + i] = iClasses[i];
+	mNumClasses[iLocus] = iNumClasses;
+	mDists[iLocus] = iDists;
+}
+
+
+// CALCULATE
+// Everything for one replicate, given how often each isolate was drawn.
+void BootstrapEngine::Calc (const vector<UInt>& iWeights,
+	BootstrapStats& oStats) const
+{
+	assert (iWeights.size() == mNumIso);
+
+	double theNumDrawn = 0.0;
+	for (UInt i = 0; i < mNumIso; i++)
+		theNumDrawn += iWeights[i];
+	double theNumPairs = theNumDrawn * (theNumDrawn - 1.0) / 2.0;
+
+	CalcPairs (iWeights, theNumPairs, oStats);
+
+	UInt theMaxClasses = 0;
+	for (UInt i = 0; i < mNumLoci; i++)
+	{
+		if (theMaxClasses < mNumClasses[i])
+			theMaxClasses = mNumClasses[i];
+	}
+	vector<double> theTally (theMaxClasses, 0.0);
+	oStats.mVarDist.resize (mNumLoci);
+	for (UInt i = 0; i < mNumLoci; i++)
+		oStats.mVarDist[i] = CalcLocusVar (i, iWeights, theTally, theNumPairs);
+}
+
+
+// DRAW WEIGHTS
+// Draw as many isolates as there are, with replacement, & count how often
+// each was drawn.
+void BootstrapEngine::DrawWeights (RandomService& ioRng, UInt iNumIso,
+	vector<UInt>& oWeights)
+{
+	oWeights.assign (iNumIso, 0);
+	for (UInt i = 0; i < iNumIso; i++)
+		oWeights[ioRng.UniformWhole (long (iNumIso))]++;
+}
+
+
+// *** INTERNALS *********************************************************/
+
+// SUM PAIRS
+// The sums over the pairs of isolates drawn, for distances of any width.
+// As in CountFreqsFromDist(), each isolate not yet counted with an earlier
+// one takes in all later ones at no distance from it.
+template <typename DIST>
+static void SumPairs (const vector<DIST>& iDists, UInt iNumIso,
+	const vector<UInt>& iWeights, vector<long>& ioFreqs, double& oSumDist,
+	double& oSumDistSq, double& oNumDiffPairs)
+{
+	long thePairNum = 0;
+
+	oSumDist = oSumDistSq = oNumDiffPairs = 0.0;
+	for (UInt i = 0; i + 1 < iNumIso; i++)
+	{
+		if (iWeights[i] == 0)
+		{
+			thePairNum += iNumIso - i - 1;
+			continue;
+		}
+		for (UInt j = i + 1; j < iNumIso; j++, thePairNum++)
+		{
+			if (iWeights[j] == 0)
+				continue;
+			double thePairs = double (iWeights[i]) * double (iWeights[j]);
+			int theDist = iDists[thePairNum];
+			if (theDist == 0)
+			{
+				if (ioFreqs[i] and ioFreqs[j])
+				{
+					ioFreqs[i] += ioFreqs[j];
+					ioFreqs[j] = 0;
+				}
+			}
+			else
+			{
+				oSumDist += thePairs * theDist;
+				oSumDistSq += thePairs * (theDist * theDist);
+				oNumDiffPairs += thePairs;
+			}
+		}
+	}
+}
+
+
+// CALCULATE PAIRS
+// The distances over all loci, in one pass over the pairs of isolates
+// drawn.
+void BootstrapEngine::CalcPairs (const vector<UInt>& iWeights,
+	double iNumPairs, BootstrapStats& oStats) const
+{
+	vector<long>	theFreqs (iWeights.begin(), iWeights.end());
+	double			theSumDist, theSumDistSq, theNumDiffPairs;
+
+	switch (mDistArray->GetWidth())
+	{
+		case kDistWidth_Byte:
+			SumPairs (mDistArray->GetBytes(), mNumIso, iWeights, theFreqs,
+				theSumDist, theSumDistSq, theNumDiffPairs);
+			break;
+		case kDistWidth_Short:
+			SumPairs (mDistArray->GetShorts(), mNumIso, iWeights, theFreqs,
+				theSumDist, theSumDistSq, theNumDiffPairs);
+			break;
+		default:
+			SumPairs (mDistArray->GetInts(), mNumIso, iWeights, theFreqs,
+				theSumDist, theSumDistSq, theNumDiffPairs);
+			break;
+	}
+
+	// pairs of copies of an isolate are at no distance
+	oStats.mVarDistObs = (theSumDistSq - theSumDist / iNumPairs *
+		theSumDist) / iNumPairs;
+	oStats.mDiversity = theNumDiffPairs / iNumPairs;
+
+	oStats.mNumDiff = oStats.mMaxFreq = 0;
+	for (UInt i = 0; i < mNumIso; i++)
+	{
+		if (theFreqs[i])
+			oStats.mNumDiff++;
+		if (oStats.mMaxFreq < theFreqs[i])
+			oStats.mMaxFreq = int (theFreqs[i]);
+	}
+}
+
+
+// CALCULATE LOCUS VARIANCE
+// With W drawn isolates of each class & distances d between classes, the
+// sum of distances over pairs of drawn isolates is half the sum over pairs
+// of classes of W1 * W2 * d, less the pairs of an isolate with itself. The
+// tally is left empty for the next locus.
+double BootstrapEngine::CalcLocusVar (UInt iLocus,
+	const vector<UInt>& iWeights, vector<double>& ioTally,
+	double iNumPairs) const
+{
+	const UInt*		theClasses = &mClasses[iLocus * mNumIso];
+	const uchar*	theDists = &mDists[iLocus][0];
+	UInt				theNumClasses = mNumClasses[iLocus];
+	vector<UInt>	thePresent;
+
+	for (UInt i = 0; i < mNumIso; i++)
+	{
+		if (iWeights[i] == 0)
+			continue;
+		if (ioTally[theClasses[i]] == 0.0)
+			thePresent.push_back (theClasses[i]);
+		ioTally[theClasses[i]] += iWeights[i];
+	}
+
+	double theSumDist = 0.0, theSumSquares = 0.0;
+	for (UInt i = 0; i < thePresent.size(); i++)
+	{
+		UInt theClass = thePresent[i];
+		double theSelfDist = theDists[(theClass * theNumClasses) + theClass];
+		theSumDist -= ioTally[theClass] * theSelfDist;
+		theSumSquares -= ioTally[theClass] * theSelfDist * theSelfDist;
+		for (UInt j = 0; j < thePresent.size(); j++)
+		{
+			double thePairs = ioTally[theClass] * ioTally[thePresent[j]];
+			double theDist = theDists[(theClass * theNumClasses) + thePresent[j]];
+			theSumDist += thePairs * theDist;
+			theSumSquares += thePairs * theDist * theDist;
+		}
+	}
+	theSumDist /= 2.0;
+	theSumSquares /= 2.0;
+
+	for (UInt i = 0; i < thePresent.size(); i++)
+		ioTally[thePresent[i]] = 0.0;
+
+	return (theSumSquares - (theSumDist * theSumDist / iNumPairs)) / iNumPairs;
+}
+
+
+// *** END ***************************************************************/
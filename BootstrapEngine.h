@@ -0,0 +1,87 @@
+/**************************************************************************
+BootstrapEngine.h - statistics of isolates resampled with replacement
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- A bootstrap replicate draws as many isolates as there are, with
+  replacement. Rather than copy the drawn isolates into a new dataset, a
+  replicate is just the number of times each isolate was drawn, its
+  weight, & the statistics are worked out from what is known of the
+  observed data.
+- The copies of one isolate are the same at every locus, so the pairs of
+  isolates in a replicate are the pairs of the observed data, each counted
+  by the product of their weights, plus pairs of copies at no distance. So
+  the sums of distances over all loci come from the observed distances
+  between isolates, worked out once.
+- The variance of distances at a locus depends only on how many of the
+  drawn isolates carry each allele (or diplotype) there, & the distances
+  between those. This is a sum over the alleles present rather than over
+  pairs of isolates.
+- The genotypes are counted as CountFreqsFromDist() would count them, if
+  the copies of each isolate followed it directly.
+- The rows needn't be every isolate. Given only the distinct genotypes of
+  a dataset, with the number of isolates of each as weights, an engine
+  gives the statistics of the whole dataset (see
+  MultiLocusModel::CalcGenotypeStats()).
+- Once filled, an engine isn't changed by working out a replicate, so one
+  engine can be shared by several threads.
+- The engine only refers to the distances between rows it is given, so
+  they must outlive it.
+- Used by the fast engine only (see engine_t in MultiLocusModel.h).
+
+**************************************************************************/
+
+#ifndef BOOTSTRAPENGINE_H
+#define BOOTSTRAPENGINE_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "RandomService.h"
+#include "PairDistArray.h"
+
+#include <vector>
+
+using std::vector;
+using namespace sbl;
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class BootstrapEngine
+{
+public:
+	// Lifecycle
+	BootstrapEngine	(const PairDistArray& iDists, UInt iNumIso,
+							UInt iNumLoci);
+
+	// Services
+	void	SetLocus		(UInt iLocus, const vector<UInt>& iClasses,
+							UInt iNumClasses, const vector<uchar>& iDists);
+	void	Calc			(const vector<UInt>& iWeights,
+							BootstrapStats& oStats) const;
+
+	static void	DrawWeights	(RandomService& ioRng, UInt iNumIso,
+								vector<UInt>& oWeights);
+
+private:
+	UInt							mNumIso;
+	UInt							mNumLoci;
+	const PairDistArray*		mDistArray;		// between rows, over all loci
+	vector<UInt>				mClasses;		// a row of classes per locus
+	vector<UInt>				mNumClasses;	// at each locus
+	vector< vector<uchar> >	mDists;			// between classes at each locus
+
+	void	CalcPairs		(const vector<UInt>& iWeights, double iNumPairs,
+							BootstrapStats& oStats) const;
+	double	CalcLocusVar	(UInt iLocus, const vector<UInt>& iWeights,
+							vector<double>& ioTally, double iNumPairs) const;
+};
+
+
+#endif
+// *** END ***************************************************************/
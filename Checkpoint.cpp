@@ -0,0 +1,282 @@
+/**************************************************************************
+Checkpoint.cpp - saved state of a partially completed randomization run
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. The file format is a simple line per field, a keyword
+  followed by tab-separated values, so that a user can inspect how far a
+  run has got with a text editor.
+- Doubles are written at full precision, as a resumed run must compare
+  randomizations against exactly the same observed values as the
+  uninterrupted run would have.
+
+To Do:
+- a checksum of the dataset would be a better guard than its dimensions.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "Checkpoint.h"
+#include "Error.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+using std::setprecision;
+using std::endl;
+using std::ios;
+using sbl::FileOpenError;
+using sbl::ParseError;
+
+
+// *** CONSTANTS & DEFINES
+
+const char*	kCheckpointHeader		= "MultiLocus checkpoint";
+const char*	kTmpSuffix				= ".tmp";
+const int	kCopyBufferSize		= 8192;
+
+
+// *** MAIN BODY *********************************************************/
+
+// *** LIFECYCLE *********************************************************/
+
+Checkpoint::Checkpoint ()
+{
+	Clear ();
+}
+
+
+void Checkpoint::Clear ()
+{
+	mAnalysis = mDataName = "";
+	mNumRows = mNumCols = mNumRandomizations = 0;
+	mShardIndex = 0;
+	mNumShards = 1;
+	mRunSeed = 1;
+	mLastReplicate = 0;
+	mObserved.clear ();
+	mExceedances.clear ();
+	mPairObserved.clear ();
+	mPairExceedances.clear ();
+	mOffsets.clear ();
+}
+
+
+// *** SERVICES **********************************************************/
+
+// WRITE
+// Save to the given path. So a crash while writing cannot destroy the
+// last good checkpoint, write to a temporary file and then swap it in.
+void Checkpoint::Write (const char* iPath)
+{
+	string theTmpPath (iPath);
+	theTmpPath += kTmpSuffix;
+
+	ofstream theOutStrm (theTmpPath.c_str());
+	if (not theOutStrm)
+		throw FileOpenError (theTmpPath.c_str());
+	theOutStrm << setprecision (17);
+
+	theOutStrm << kCheckpointHeader << endl;
+	theOutStrm << "analysis\t" << mAnalysis << endl;
+	theOutStrm << "data\t" << mDataName << endl;
+	theOutStrm << "dimensions\t" << mNumRows << "\t" << mNumCols << endl;
+	theOutStrm << "randomizations\t" << mNumRandomizations << endl;
+	theOutStrm << "shard\t" << mShardIndex << "\t" << mNumShards << endl;
+	theOutStrm << "seed\t" << mRunSeed << endl;
+	theOutStrm << "replicate\t" << mLastReplicate << endl;
+
+	theOutStrm << "observed\t" << mObserved.size();
+	for (UInt i = 0; i < mObserved.size(); i++)
+		theOutStrm << "\t" << mObserved[i];
+	theOutStrm << endl;
+
+	theOutStrm << "exceedances\t" << mExceedances.size();
+	for (UInt i = 0; i < mExceedances.size(); i++)
+		theOutStrm << "\t" << mExceedances[i];
+	theOutStrm << endl;
+
+	theOutStrm << "pair_observed\t" << mPairObserved.size();
+	for (UInt i = 0; i < mPairObserved.size(); i++)
+		theOutStrm << "\t" << mPairObserved[i];
+	theOutStrm << endl;
+
+	theOutStrm << "pair_exceedances\t" << mPairExceedances.size();
+	for (UInt i = 0; i < mPairExceedances.size(); i++)
+		theOutStrm << "\t" << mPairExceedances[i];
+	theOutStrm << endl;
+
+	offsetMap_t::iterator q;
+	for (q = mOffsets.begin(); q != mOffsets.end(); q++)
+		theOutStrm << "offset\t" << q->first << "\t" << q->second << endl;
+
+	theOutStrm.close ();
+	if (not theOutStrm)
+		throw Error ("could not write checkpoint");
+
+	std::remove (iPath);
+	if (std::rename (theTmpPath.c_str(), iPath) != 0)
+		throw Error ("could not replace checkpoint");
+}
+
+
+// READ
+// Load a previously written checkpoint. Unknown keywords are an error, as
+// they probably mean the file is not a checkpoint at all. So are observed
+// values & counts other than the iNumStats of the analysis being resumed,
+// or pairwise values without their counts, as the model indexes them
+// directly.
+void Checkpoint::Read (const char* iPath, UInt iNumStats)
+{
+	Clear ();
+
+	ifstream theInStrm (iPath);
+	if (not theInStrm)
+		throw FileOpenError (iPath);
+
+	string theLine;
+	std::getline (theInStrm, theLine);
+	if (theLine != kCheckpointHeader)
+		throw ParseError ("not a checkpoint file", iPath);
+
+	long theLineNum = 1;
+	while (std::getline (theInStrm, theLine))
+	{
+		theLineNum++;
+		if (theLine == "")
+			continue;
+
+		string::size_type theTabPosn = theLine.find ('\t');
+		string theKey = theLine.substr (0, theTabPosn);
+		string theValues = (theTabPosn == string::npos) ? string("") :
+			theLine.substr (theTabPosn + 1);
+		istringstream theValStrm (theValues);
+		UInt theSize = 0;
+
+		if (theKey == "analysis")
+			mAnalysis = theValues;
+		else if (theKey == "data")
+			mDataName = theValues;
+		else if (theKey == "dimensions")
+			theValStrm >> mNumRows >> mNumCols;
+		else if (theKey == "randomizations")
+			theValStrm >> mNumRandomizations;
+		else if (theKey == "shard")
+			theValStrm >> mShardIndex >> mNumShards;
+		else if (theKey == "seed")
+			theValStrm >> mRunSeed;
+		else if (theKey == "replicate")
+			theValStrm >> mLastReplicate;
+		else if (theKey == "observed")
+		{
+			theValStrm >> theSize;
+			mObserved.resize (theSize);
+			for (UInt i = 0; i < theSize; i++)
+				theValStrm >> mObserved[i];
+		}
+		else if (theKey == "exceedances")
+		{
+			theValStrm >> theSize;
+			mExceedances.resize (theSize);
+			for (UInt i = 0; i < theSize; i++)
+				theValStrm >> mExceedances[i];
+		}
+		else if (theKey == "pair_observed")
+		{
+			theValStrm >> theSize;
+			mPairObserved.resize (theSize);
+			for (UInt i = 0; i < theSize; i++)
+				theValStrm >> mPairObserved[i];
+		}
+		else if (theKey == "pair_exceedances")
+		{
+			theValStrm >> theSize;
+			mPairExceedances.resize (theSize);
+			for (UInt i = 0; i < theSize; i++)
+				theValStrm >> mPairExceedances[i];
+		}
+		else if (theKey == "offset")
+		{
+			string	theFileKey;
+			long		theOffset;
+			theValStrm >> theFileKey >> theOffset;
+			mOffsets[theFileKey] = theOffset;
+		}
+		else
+		{
+			throw ParseError (theLineNum, "unknown checkpoint field");
+		}
+
+		if (theValStrm.fail() and (theKey != "analysis") and (theKey != "data"))
+			throw ParseError (theLineNum, "malformed checkpoint field");
+	}
+	
+	if ((mObserved.size() != iNumStats) or (mExceedances.size() != iNumStats) or
+		(mPairObserved.size() != mPairExceedances.size()))
+		throw ParseError ("checkpoint statistics do not fit the analysis", iPath);
+}
+
+
+bool Checkpoint::Exists (const char* iPath)
+{
+	ifstream theInStrm (iPath);
+	return bool (theInStrm);
+}
+
+
+void Checkpoint::Remove (const char* iPath)
+{
+	std::remove (iPath);
+}
+
+
+// REWIND FILE
+// Cut a file back to the given length, discarding anything written after
+// the checkpoint was taken. There's no portable truncate, so copy the
+// part we keep and swap it in.
+void Checkpoint::RewindFile (const char* iPath, long iOffset)
+{
+	assert (0 <= iOffset);
+
+	string theTmpPath (iPath);
+	theTmpPath += kTmpSuffix;
+
+	ifstream theInStrm (iPath, ios::in | ios::binary);
+	if (not theInStrm)
+		throw FileOpenError (iPath);
+	ofstream theOutStrm (theTmpPath.c_str(), ios::out | ios::binary);
+	if (not theOutStrm)
+		throw FileOpenError (theTmpPath.c_str());
+
+	char theBuffer[kCopyBufferSize];
+	long theNumLeft = iOffset;
+	while (0 < theNumLeft)
+	{
+		long theChunkSize = (theNumLeft < kCopyBufferSize) ? theNumLeft :
+			kCopyBufferSize;
+		theInStrm.read (theBuffer, theChunkSize);
+		if (theInStrm.gcount() != theChunkSize)
+			throw Error ("output file is shorter than its checkpoint");
+		theOutStrm.write (theBuffer, theChunkSize);
+		theNumLeft -= theChunkSize;
+	}
+
+	theInStrm.close ();
+	theOutStrm.close ();
+	std::remove (iPath);
+	if (std::rename (theTmpPath.c_str(), iPath) != 0)
+		throw Error ("could not rewind output file");
+}
+
+
+// *** END ***************************************************************/
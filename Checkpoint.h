@@ -0,0 +1,90 @@
+/**************************************************************************
+Checkpoint.h - saved state of a partially completed randomization run
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- Long randomization runs (CalcDiversity, the theta loops) can be
+  periodically saved to a small text file, so that a crashed or killed
+  run can be picked up again from the last saved replicate. What needs
+  saving is little: the seed of the run (each replicate reseeds the RNG
+  from this and its own number), the last replicate finished, the counts
+  of replicates at least as extreme as the observed data, the observed
+  values and how far each output file had been written.
+- The checkpoint knows nothing of the analysis itself, it is just a
+  container with file input & output. The model fills it & checks it.
+
+**************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+using std::string;
+using std::vector;
+using std::map;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+typedef map<string, long>	offsetMap_t;	// output file -> bytes written
+
+// names of the output files noted in checkpoints
+const char	kOutput_Stats[]		= "stats";
+const char	kOutput_Pairs[]		= "pairs";
+const char	kOutput_Paup[]			= "paup";
+const char	kOutput_Theta[]		= "theta";
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class Checkpoint
+{
+public:
+	// Lifecycle
+	Checkpoint	();
+
+	// Services
+	void	Write		(const char* iPath);
+	void	Read		(const char* iPath, UInt iNumStats);
+	void	Clear		();
+
+	static bool	Exists		(const char* iPath);
+	static void	Remove		(const char* iPath);
+	static void	RewindFile	(const char* iPath, long iOffset);
+
+	// what was being done
+	string				mAnalysis;			// e.g. "diversity" or "theta"
+	string				mDataName;
+	UInt					mNumRows;
+	UInt					mNumCols;
+	UInt					mNumRandomizations;
+	UInt					mShardIndex;
+	UInt					mNumShards;
+
+	// how far it got
+	long					mRunSeed;
+	UInt					mLastReplicate;	// last replicate completed
+
+	// the statistics gathered so far
+	vector<double>		mObserved;			// values for the original data
+	vector<UInt>		mExceedances;		// as extreme or more than observed
+	vector<double>		mPairObserved;		// as above for pairwise stats
+	vector<double>		mPairExceedances;
+	offsetMap_t			mOffsets;
+};
+
+
+#endif
+// *** END ***************************************************************/
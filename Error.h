@@ -56,6 +56,7 @@ To Do:
 #include "Sbl.h"
 #include <string>
 #include <exception>
+#include <cstring>
 
 SBL_NAMESPACE_START
 
@@ -0,0 +1,160 @@
+/**************************************************************************
+FlatMatrix.h - a matrix of cells held in a single block
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- Rows of cells laid end to end in one vector, rather than a vector of
+  separately allocated rows. Indexing a row gives a pointer to its first
+  cell, so cells are still got at as iMatrix[row][col].
+- The matrix owns its cells, so it can be kept by value & copied, moved
+  or swapped whole. A copy is one allocation, however many rows.
+- Every row is as long as the first one added. Rows may have no cells,
+  so rows are found from the start of the block rather than by indexing
+  into it.
+
+Changes:
+- Rows & columns can be picked out of another matrix in one pass.
+
+**************************************************************************/
+
+#ifndef FLATMATRIX_H
+#define FLATMATRIX_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+
+#include <vector>
+#include <cassert>
+
+using std::vector;
+using namespace sbl;
+
+
+// *** CLASS DECLARATION *************************************************/
+
+template <typename CELL>
+class FlatMatrix
+{
+public:
+	// Lifecycle
+	FlatMatrix ()
+		: mNumRows (0), mNumCols (0)
+		{}
+	FlatMatrix (UInt iNumRows, UInt iNumCols, const CELL& iCell = CELL())
+		: mNumRows (iNumRows), mNumCols (iNumCols),
+		mCells (iNumRows * iNumCols, iCell)
+		{}
+
+	// Access
+	UInt	size			() const	{ return mNumRows; }
+	bool	empty			() const	{ return (mNumRows == 0); }
+	UInt	GetNumRows	() const	{ return mNumRows; }
+	UInt	GetNumCols	() const	{ return mNumCols; }
+
+	CELL* operator[] (UInt iRow)
+	{
+		assert (iRow < mNumRows);
+		return mCells.data() + (iRow * mNumCols);
+	}
+
+	const CELL* operator[] (UInt iRow) const
+	{
+		assert (iRow < mNumRows);
+		return mCells.data() + (iRow * mNumCols);
+	}
+
+	// Manipulation
+	void	clear			();
+	void	AddRow		(const vector<CELL>& iRow);
+	void	CopyRow		(UInt iToRow, const FlatMatrix& iFrom, UInt iFromRow);
+	void	CopySelected	(const FlatMatrix& iFrom, const vector<bool>& iRows,
+							const vector<bool>& iCols);
+
+private:
+	UInt				mNumRows;
+	UInt				mNumCols;
+	vector<CELL>	mCells;		// row after row
+};
+
+
+// *** TEMPLATE MEMBERS **************************************************/
+
+template <typename CELL>
+void FlatMatrix<CELL>::clear ()
+{
+	mNumRows = mNumCols = 0;
+	mCells.clear ();
+}
+
+
+// ADD ROW
+// The first row sets the number of columns.
+template <typename CELL>
+void FlatMatrix<CELL>::AddRow (const vector<CELL>& iRow)
+{
+	if (mNumRows == 0)
+		mNumCols = iRow.size();
+	assert (iRow.size() == mNumCols);
+	mCells.insert (mCells.end(), iRow.begin(), iRow.end());
+	mNumRows++;
+}
+
+
+template <typename CELL>
+void FlatMatrix<CELL>::CopyRow (UInt iToRow, const FlatMatrix& iFrom,
+	UInt iFromRow)
+{
+	assert (iFrom.mNumCols == mNumCols);
+	const CELL* theFrom = iFrom[iFromRow];
+	CELL* theTo = (*this)[iToRow];
+	for (UInt j = 0; j < mNumCols; j++)
+		theTo[j] = theFrom[j];
+}
+
+
+// COPY SELECTED
+// Become the cells of another matrix in the rows & columns flagged, in
+// one pass.
+template <typename CELL>
+void FlatMatrix<CELL>::CopySelected (const FlatMatrix& iFrom,
+	const vector<bool>& iRows, const vector<bool>& iCols)
+{
+	assert (this != &iFrom);
+	assert (iRows.size() == iFrom.mNumRows);
+	assert (iCols.size() == iFrom.mNumCols);
+	
+	mNumRows = mNumCols = 0;
+	for (UInt i = 0; i < iFrom.mNumRows; i++)
+	{
+		if (iRows[i])
+			mNumRows++;
+	}
+	for (UInt j = 0; j < iFrom.mNumCols; j++)
+	{
+		if (iCols[j])
+			mNumCols++;
+	}
+	
+	mCells.resize (mNumRows * mNumCols);
+	UInt theNext = 0;
+	for (UInt i = 0; i < iFrom.mNumRows; i++)
+	{
+		if (not iRows[i])
+			continue;
+		const CELL* theFrom = iFrom[i];
+		for (UInt j = 0; j < iFrom.mNumCols; j++)
+		{
+			if (iCols[j])
+				mCells[theNext++] = theFrom[j];
+		}
+	}
+}
+
+
+#endif
+// *** END ***************************************************************/
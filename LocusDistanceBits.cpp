@@ -0,0 +1,134 @@
+/**************************************************************************
+LocusDistanceBits.cpp - the distances at every locus, packed as bits
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. The bits are counted a 64-bit word at a time, which is as
+  much width as can be had without resorting to machine-specific code.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "LocusDistanceBits.h"
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+
+// *** CONSTANTS & DEFINES
+
+// the tiles: a block of loci by a stretch of words, small enough that two
+// blocks of both planes sit in cache together
+const UInt	kBlockLoci		= 32;
+const UInt	kBlockWords		= 128;
+
+
+// *** LOCAL FUNCTIONS ***************************************************/
+
+// COUNT BITS
+// Done by halves, quarters etc. within the word, which the compiler can
+// spread across vector registers where a popcount instruction can't be
+// assumed.
+static inline long CountBits (unsigned long long iWord)
+{
+	iWord -= (iWord >> 1) & 0x5555555555555555ULL;
+	iWord = (iWord & 0x3333333333333333ULL) +
+		((iWord >> 2) & 0x3333333333333333ULL);
+	iWord = (iWord + (iWord >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return long ((iWord * 0x0101010101010101ULL) >> 56);
+}
+
+
+// *** MAIN BODY *********************************************************/
+
+// CALCULATE CROSS PRODUCTS
+// For every pair of loci, the sum over pairs of isolates of d1 * d2. Each
+// stretch of words is done for every pair of blocks before moving on.
+void LocusDistanceBits::CalcCrossProducts ()
+{
+	mCrossProducts.assign ((mNumLoci * (mNumLoci - 1)) / 2, 0);
+	for (UInt w = 0; w < mNumWords; w += kBlockWords)
+	{
+		UInt theLastWord = min (w + kBlockWords, mNumWords);
+		for (UInt i = 0; i < mNumLoci; i += kBlockLoci)
+		{
+			UInt theLast1 = min (i + kBlockLoci, mNumLoci);
+			for (UInt j = i; j < mNumLoci; j += kBlockLoci)
+				CountBlockPair (i, theLast1, j, min (j + kBlockLoci, mNumLoci),
+					w, theLastWord);
+		}
+	}
+}
+
+
+// PAIR MOMENTS
+// Of the distance d1 + d2 summed over two loci, as CalcPairwiseStats()
+// would find them. CalcCrossProducts() must have been called.
+void LocusDistanceBits::PairMoments
+(UInt iLocus1, UInt iLocus2, double& oSumDist, double& oSumSqDist) const
+{
+	assert (iLocus1 < iLocus2);
+	assert (mCrossProducts.size() == (mNumLoci * (mNumLoci - 1)) / 2);
+
+	long theCross = mCrossProducts[GetPairIndex (iLocus1, iLocus2)];
+	oSumDist = mSums[iLocus1] + mSums[iLocus2];
+	oSumSqDist = mSumSquares[iLocus1] + mSumSquares[iLocus2] + (2 * theCross);
+}
+
+
+// *** INTERNALS *********************************************************/
+
+// the pairs of loci are in the order of CalcPairwiseStats()
+UInt LocusDistanceBits::GetPairIndex (UInt iLocus1, UInt iLocus2) const
+{
+	return ((iLocus1 * ((2 * mNumLoci) - iLocus1 - 1)) / 2) +
+		(iLocus2 - iLocus1 - 1);
+}
+
+
+// COUNT BLOCK PAIR
+// Add the overlaps of two blocks of loci, over a stretch of words. Where
+// the planes overlap, d1 * d2 is 1, 2 or 4. Without a plane of 2s, only
+// the 1s are counted.
+void LocusDistanceBits::CountBlockPair (UInt iFirst1, UInt iLast1,
+	UInt iFirst2, UInt iLast2, UInt iFirstWord, UInt iLastWord)
+{
+	bool theHasTwos = not mTwos.empty();
+	for (UInt i = iFirst1; i < iLast1; i++)
+	{
+		const word_t* theOnes1 = &mOnes[ulong (i) * mNumWords];
+		for (UInt j = max (iFirst2, i + 1); j < iLast2; j++)
+		{
+			const word_t* theOnes2 = &mOnes[ulong (j) * mNumWords];
+			long theCross = 0;
+			if (theHasTwos)
+			{
+				const word_t* theTwos1 = &mTwos[ulong (i) * mNumWords];
+				const word_t* theTwos2 = &mTwos[ulong (j) * mNumWords];
+				for (UInt w = iFirstWord; w < iLastWord; w++)
+				{
+					theCross += CountBits (theOnes1[w] & theOnes2[w]) +
+						(2 * (CountBits (theOnes1[w] & theTwos2[w]) +
+						CountBits (theTwos1[w] & theOnes2[w]))) +
+						(4 * CountBits (theTwos1[w] & theTwos2[w]));
+				}
+			}
+			else
+			{
+				for (UInt w = iFirstWord; w < iLastWord; w++)
+					theCross += CountBits (theOnes1[w] & theOnes2[w]);
+			}
+			mCrossProducts[GetPairIndex (i, j)] += theCross;
+		}
+	}
+}
+
+
+// *** END ***************************************************************/
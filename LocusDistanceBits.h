@@ -0,0 +1,117 @@
+/**************************************************************************
+LocusDistanceBits.h - the distances at every locus, packed as bits
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- The distance between every pair of isolates at each locus, packed as
+  bits: one plane for distances of 1 &, for diploid data, one for 2. The
+  second plane is only made once a distance of 2 turns up, so it takes
+  no room for haploid data.
+- The statistics of a pair of loci need the sum of d1 + d2 over pairs of
+  isolates & of its square. The first is just the sums for each locus,
+  the second theirs plus twice the sum of d1 * d2, which is the overlap
+  of their planes weighted 1, 2 or 4. So the distances are worked out
+  once per locus, not once for every pair of loci it is in.
+- The overlaps for all pairs of loci are counted in one pass, tiled so
+  that a block of loci is reused from cache while it is paired with every
+  other block, a stretch of words at a time, like a matrix product.
+- Used by the fast engine only (see engine_t in MultiLocusModel.h).
+
+**************************************************************************/
+
+#ifndef LOCUSDISTANCEBITS_H
+#define LOCUSDISTANCEBITS_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "MultiLocusModel.h"
+
+#include <vector>
+
+using std::vector;
+using namespace sbl;
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class LocusDistanceBits
+{
+public:
+	template <typename CELL, typename METRIC>
+	void	Fill					(const FlatMatrix<CELL>& iData, const METRIC& iMetric);
+	void	CalcCrossProducts	();
+	void	PairMoments			(UInt iLocus1, UInt iLocus2, double& oSumDist,
+										double& oSumSqDist) const;
+
+private:
+	typedef unsigned long long	word_t;
+
+	UInt				mNumLoci;
+	UInt				mNumWords;		// per locus
+	vector<word_t>	mOnes;			// a row of words per locus
+	vector<word_t>	mTwos;			// empty if there are no distances of 2
+	vector<long>	mSums;			// of the distances at each locus
+	vector<long>	mSumSquares;
+	vector<long>	mCrossProducts;	// for each pair of loci, in order
+
+	UInt	GetPairIndex		(UInt iLocus1, UInt iLocus2) const;
+	void	CountBlockPair		(UInt iFirst1, UInt iLast1, UInt iFirst2,
+										UInt iLast2, UInt iFirstWord, UInt iLastWord);
+};
+
+
+// *** TEMPLATE MEMBERS **************************************************/
+
+// FILL
+// Pairs of isolates are numbered as in CalcPairwiseStats(), although any
+// order would do as long as it is the same for every locus.
+template <typename CELL, typename METRIC>
+void LocusDistanceBits::Fill (const FlatMatrix<CELL>& iData, const METRIC& iMetric)
+{
+	const UInt kWordBits = 64;
+	UInt theNumIso = iData.size();
+	ulong theNumPairs = (ulong (theNumIso) * (theNumIso - 1)) / 2;
+
+	mNumLoci = iData.GetNumCols();
+	mNumWords = (theNumPairs + kWordBits - 1) / kWordBits;
+	mOnes.assign (ulong (mNumLoci) * mNumWords, 0);
+	mTwos.clear();
+	mSums.assign (mNumLoci, 0);
+	mSumSquares.assign (mNumLoci, 0);
+	mCrossProducts.clear();
+
+	for (UInt i = 0; i < mNumLoci; i++)
+	{
+		word_t* theOnes = &mOnes[ulong (i) * mNumWords];
+		ulong thePairNum = 0;
+		for (UInt k = 1; k < theNumIso; k++)
+		{
+			const CELL& theCell = iData[k][i];
+			for (UInt m = 0; m < k; m++, thePairNum++)
+			{
+				int theDist = iMetric.Between (i, theCell, iData[m][i]);
+				word_t theBit = word_t (1) << (thePairNum % kWordBits);
+				if (theDist == 1)
+					theOnes[thePairNum / kWordBits] |= theBit;
+				else if (theDist == 2)
+				{
+					if (mTwos.empty())
+						mTwos.assign (ulong (mNumLoci) * mNumWords, 0);
+					mTwos[(ulong (i) * mNumWords) + (thePairNum / kWordBits)] |=
+						theBit;
+				}
+				mSums[i] += theDist;
+				mSumSquares[i] += theDist * theDist;
+			}
+		}
+	}
+}
+
+
+#endif
+// *** END ***************************************************************/
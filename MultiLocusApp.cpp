@@ -72,6 +72,8 @@ To Do:
 
 #include "StringUtils.h"
 #include "Combination.h"
+#include "Checkpoint.h"
+#include "ShardMerge.h"
 
 #include <fstream>
 #include <iostream>
@@ -106,6 +108,9 @@ enum multiLocusCmd_t
 	kCmd_Diversity,
 	kCmd_PopDiff,
 	kCmd_PlotDiv,
+	kCmd_Windows,
+	kCmd_Jackknife,
+	kCmd_Bootstrap,
 	kCmd_Part,
 	kCmd_Print,
 	kCmd_LinkView,
@@ -115,18 +120,55 @@ enum multiLocusCmd_t
 	kCmd_ExcludeLoci,	
 	kCmd_FixMissing,
 	kCmd_FreeMissing,
+	kCmd_SamplePairs,
+	kCmd_AllPairs,
+	kCmd_MergeShards,
 	kCmd_Return
 };
 
 const int	kMaxDiffCharacters	= 128;	// to represent alleles
 const int 	kMaxFileNameLength	= 31;		// obvious
+const int	kMaxSuffixLength		= 6;		// longest of those below
+const long	kMaxJobSeed				= 2147483646L;
 
 const char	kPartFileSuffix[] 	= ".part";
 const char	kPlotFileSuffix[] 	= ".plot";
+const char	kWindowFileSuffix[]	= ".wind";
+const char	kJackFileSuffix[]		= ".jack";
+const char	kBootFileSuffix[]		= ".boot";
 const char	kPaupFileSuffix[]		= ".paup";
 const char	kStatFileSuffix[]		= ".stats";
 const char	kPairFileSuffix[]		= ".pairs";
 const char	kThetaFileSuffix[]	= ".theta";
+const char	kCheckpointSuffix[]	= ".ckpt";
+const char	kProgressSuffix[]		= ".progress";
+
+
+// *** UTILITIES *********************************************************/
+#pragma mark --
+
+// OPEN OUTPUT FILE
+// Open a results file fresh or, when resuming from a checkpoint, cut it
+// back to where the checkpoint was taken and open it for appending.
+void OpenOutputFile (ofstream& oFileStream, const string& iFileName,
+	Checkpoint* iResumePoint, const char* iOutputName)
+{
+	if (iResumePoint == NULL)
+	{
+		oFileStream.open (iFileName.c_str());
+	}
+	else
+	{
+		offsetMap_t::iterator q = iResumePoint->mOffsets.find (iOutputName);
+		if (q == iResumePoint->mOffsets.end())
+			throw Error ("the checkpoint does not match this analysis");
+		Checkpoint::RewindFile (iFileName.c_str(), q->second);
+		oFileStream.open (iFileName.c_str(), ios::out | ios::app);
+	}
+	
+	if (not oFileStream)
+		throw FileOpenError (iFileName.c_str());
+}
 
 
 // *** MAIN BODY *********************************************************/
@@ -171,12 +213,16 @@ void MultiLocusApp::LoadMenu ()
 	mMainCommands.AddCommand (kCmd_Open, 'o', "Open new datafile");	
 	mMainCommands.AddCommand (kCmd_DefLink, '1', "Define linkage groups");			
 	mMainCommands.AddCommand (kCmd_DefPop, '2', "Define population groups");			
-	mMainCommands.AddCommand (kCmd_Prefs, '3', "Set preferences for handling missing data");			
+	mMainCommands.AddCommand (kCmd_Prefs, '3', "Set preferences for missing data & large datasets");			
 	mMainCommands.AddCommand (kCmd_Diversity, 'g', "Calc. genotypic diversity & linkage disequilibrium");			
 	mMainCommands.AddCommand (kCmd_PlotDiv, 'l', "Plot genotypic diversity vs number of loci");			
+	mMainCommands.AddCommand (kCmd_Windows, 'w', "Calc. linkage disequilibrium in windows of loci");			
+	mMainCommands.AddCommand (kCmd_Jackknife, 'j', "Calc. linkage disequilibrium with each locus removed");			
+	mMainCommands.AddCommand (kCmd_Bootstrap, 'b', "Bootstrap intervals for diversity & linkage disequilibrium");			
 	mMainCommands.AddCommand (kCmd_PopDiff, 'd', "Population differentiation analysis");			
 	mMainCommands.AddCommand (kCmd_Part, 'r', "Test for partitions (haploids only)");			
 	mMainCommands.AddCommand (kCmd_Print, 'p', "Print dataset to screen");		
+	mMainCommands.AddCommand (kCmd_MergeShards, 'm', "Merge results of a sharded run");		
 	mMainCommands.AddCommand (kCmd_Quit, 'q', "Quit");	
 	mMainCommands.SetConvertShortcut (true);
 	SetCmdVisibility (false);
@@ -217,6 +263,18 @@ void MultiLocusApp::ObeyCmd (cmdId_t iCmdId)
 				CalcPlotDiv ();
 				break;
 
+			case kCmd_Windows:
+				CalcWindows ();
+				break;
+
+			case kCmd_Jackknife:
+				CalcJackknife ();
+				break;
+
+			case kCmd_Bootstrap:
+				CalcBootstrap ();
+				break;
+
 			case kCmd_PopDiff:
 				CalcPopDiffChoice ();
 				break;
@@ -229,6 +287,10 @@ void MultiLocusApp::ObeyCmd (cmdId_t iCmdId)
 				PrintDataSet ();
 				break;
 
+			case kCmd_MergeShards:
+				MergeShards ();
+				break;
+
 			case kCmd_Quit:
 				break;
 
@@ -262,6 +324,7 @@ bool MultiLocusApp::UpdateCmd (cmdId_t iCmdId)
 	switch (iCmdId)
 	{
 		case kCmd_Open:
+		case kCmd_MergeShards:
 		case kCmd_Quit:
 			return true;
 			break;
@@ -271,6 +334,9 @@ bool MultiLocusApp::UpdateCmd (cmdId_t iCmdId)
 		case kCmd_Prefs:
 		case kCmd_Diversity:
 		case kCmd_PlotDiv:
+		case kCmd_Windows:
+		case kCmd_Jackknife:
+		case kCmd_Bootstrap:
 		case kCmd_PopDiff:
 		case kCmd_Print:
 			if (mModel != NULL)
@@ -323,11 +389,14 @@ void MultiLocusApp::FindParts ()
 			theNumRandomizations = AskIntWithMinQuestion ("Number of randomizations", 1);
 		else
 			theNumRandomizations = 0;
+		string theShardTag = AskShardSettings (theNumRandomizations, false);
 
 		// prepare stream for results
 		ofstream	thePartFileStream;
 		string	thePartFileName (mDataFilePath);
-		StringConcat (thePartFileName, kPartFileSuffix, kMaxFileNameLength);
+		theShardTag += kPartFileSuffix;
+		StringConcat (thePartFileName, theShardTag.c_str(), kMaxFileNameLength);
+		AskProgressLog (theNumRandomizations, thePartFileName);
 		thePartFileStream.open(thePartFileName.c_str());
 		if (not thePartFileStream)
 			throw FileOpenError (thePartFileName.c_str());
@@ -337,6 +406,7 @@ void MultiLocusApp::FindParts ()
 
 		// tidy up
 		thePartFileStream.close();
+		mProgressLog.Close();
 		
 		// print informative closing message
 		cout << "Finished. ";
@@ -391,21 +461,28 @@ void MultiLocusApp::CalcPopDiff ()
 			theNumRandomizations = AskIntWithMinQuestion ("Number of randomizations", 1);
 		else
 			theNumRandomizations = 0;
+		string theShardTag = AskShardSettings (theNumRandomizations);
 
-		// Open stream for results to go into
+		// Open stream for results to go into, after offering to resume or
+		// checkpoint long runs
 		// TO DO: what about pops suffix?
 		ofstream	theThetaFileStream;
 		string	theThetaFileName (mDataFilePath);
-		StringConcat (theThetaFileName, kThetaFileSuffix, kMaxFileNameLength);
-		theThetaFileStream.open(theThetaFileName.c_str());
-		if (not theThetaFileStream)
-			throw FileOpenError (theThetaFileName.c_str());
+		theShardTag += kThetaFileSuffix;
+		StringConcat (theThetaFileName, theShardTag.c_str(), kMaxFileNameLength);
+		Checkpoint		theResumePoint;
+		Checkpoint*		theResumePtr = AskCheckpointSettings (theNumRandomizations,
+			theThetaFileName, kAnalysis_Theta, false, theResumePoint);
+		AskProgressLog (theNumRandomizations, theThetaFileName);
+		OpenOutputFile (theThetaFileStream, theThetaFileName, theResumePtr,
+			kOutput_Theta);
 			
 		// Do actual calculations
 		double theResult = mModel->CalcThetaLoop (theThetaFileStream, theNumRandomizations);
 		
 		// tidy up
 		theThetaFileStream.close();
+		mProgressLog.Close();
 		cout << "Finished. Original data has a theta of " << theResult << "." << endl;
 		cout << "Results saved in " << theThetaFileName << "." << endl;
 	}
@@ -489,6 +566,7 @@ void MultiLocusApp::CalcPopDiffChoice ()
 			theNumRandomizations = AskIntWithMinQuestion ("Number of randomizations", 1);
 		else
 			theNumRandomizations = 0;
+		string theShardTag = AskShardSettings (theNumRandomizations);
 
 		// build file name suffix
 		stringstream theFileSuffixStrm;
@@ -504,18 +582,23 @@ void MultiLocusApp::CalcPopDiffChoice ()
 			theFileSuffixStrm << theSelectedPops[theSelectedPops.Size() - 1];
 			
 		}
-		theFileSuffixStrm << ".theta" << ends;
+		theFileSuffixStrm << theShardTag << ".theta" << ends;
 		
 		// build whole file name
 		string	theThetaFileName (mDataFilePath);
 		string	theThetaSuffixStr = theFileSuffixStrm.str();
 		StringConcat (theThetaFileName, theThetaSuffixStr.c_str(), kMaxFileNameLength);
 		
+		// for long runs, offer to resume or checkpoint
+		Checkpoint		theResumePoint;
+		Checkpoint*		theResumePtr = AskCheckpointSettings (theNumRandomizations,
+			theThetaFileName, kAnalysis_ThetaChoice, false, theResumePoint);
+		AskProgressLog (theNumRandomizations, theThetaFileName);
+		
 		// Open stream for results to go into
 		ofstream	theThetaFileStream;
-		theThetaFileStream.open(theThetaFileName.c_str());
-		if (not theThetaFileStream)
-			throw FileOpenError (theThetaFileName.c_str());
+		OpenOutputFile (theThetaFileStream, theThetaFileName, theResumePtr,
+			kOutput_Theta);
 		
 		//DBG_BLOCK
 		//(
@@ -528,6 +611,7 @@ void MultiLocusApp::CalcPopDiffChoice ()
 		
 		// tidy up
 		theThetaFileStream.close();
+		mProgressLog.Close();
 		cout << "Finished. Original data has a theta of " << theResult << "." << endl;
 		cout << "Results saved in " << theThetaFileName << "." << endl;
 	}
@@ -582,6 +666,145 @@ void MultiLocusApp::CalcPlotDiv ()
 }
 
 
+// CALC WINDOWS
+// The index of association & rBarD in sliding windows of loci, for data
+// where the loci are in order along the genome.
+void MultiLocusApp::CalcWindows ()
+{
+	try
+	{
+		cout << endl;
+		
+		// 1. check for appropriate conditions
+		UInt theNumLoci = mModel->GetNumCols();
+		if (theNumLoci < 2)
+		{
+			ReportError ("Windows of loci require 2 or more loci");
+			return;
+		}
+		
+		// 2. ask for parameters
+		UInt theWidth = AskIntWithBoundsQuestion ("Number of loci in each window",
+			2, theNumLoci);
+		UInt theStep = AskIntWithBoundsQuestion ("Number of loci between windows",
+			1, theNumLoci);
+		int theNumRandomizations = 0;
+		if (AskYesNoQuestion ("Generate & analyse randomized datasets"))
+			theNumRandomizations = AskIntWithMinQuestion ("Number of randomizations", 1);
+
+		// 3. init & open files for output
+		ofstream	theWindowFileStream;
+		string theWindowFileName = mDataFilePath;
+		StringConcat (theWindowFileName, kWindowFileSuffix, kMaxFileNameLength);
+		AskProgressLog (theNumRandomizations, theWindowFileName);
+		theWindowFileStream.open(theWindowFileName.c_str());
+		if (not theWindowFileStream)
+			throw FileOpenError (theWindowFileName.c_str());
+					
+		// 4. actually do the work
+		ReportProgress("Calculating windows");
+		mModel->CalcWindows (theWidth, theStep, theNumRandomizations,
+			theWindowFileStream);
+		
+		// 5. Tidy up and report finish
+		theWindowFileStream.close ();
+		mProgressLog.Close();
+		cout << "Finished. Results saved in " << theWindowFileName << "." << endl;
+	}
+	catch (...)
+	{
+		throw;	// Handled by ObeyCommand() now
+	}
+}
+
+
+// CALC JACKKNIFE
+// The index of association & rBarD with each locus removed in turn, to
+// find the loci that any linkage disequilibrium comes from.
+void MultiLocusApp::CalcJackknife ()
+{
+	try
+	{
+		cout << endl;
+		
+		// 1. check for appropriate conditions
+		if (mModel->GetNumCols() < 3)
+		{
+			ReportError ("Removing loci requires 3 or more loci");
+			return;
+		}
+		
+		// 2. init & open files for output
+		ofstream	theJackFileStream;
+		string theJackFileName = mDataFilePath;
+		StringConcat (theJackFileName, kJackFileSuffix, kMaxFileNameLength);
+		theJackFileStream.open(theJackFileName.c_str());
+		if (not theJackFileStream)
+			throw FileOpenError (theJackFileName.c_str());
+					
+		// 3. actually do the work
+		ReportProgress("Removing each locus");
+		mModel->CalcJackknife (theJackFileStream);
+		
+		// 4. Tidy up and report finish
+		theJackFileStream.close ();
+		cout << "Finished. Results saved in " << theJackFileName << "." << endl;
+	}
+	catch (...)
+	{
+		throw;	// Handled by ObeyCommand() now
+	}
+}
+
+
+// CALC BOOTSTRAP
+// Confidence intervals for diversity & linkage disequilibrium, from
+// resampling the isolates with replacement.
+void MultiLocusApp::CalcBootstrap ()
+{
+	try
+	{
+		cout << endl;
+		
+		// 1. check for appropriate conditions
+		if (mModel->GetNumRows() < 3)
+		{
+			ReportError ("Resampling isolates requires 3 or more isolates");
+			return;
+		}
+		
+		// 2. ask for parameters
+		UInt theNumReplicates = AskIntWithMinQuestion
+			("Number of bootstrap replicates", 1);
+		int theConfidence = AskIntWithBoundsQuestion
+			("Confidence level (%)", 50, 99);
+		
+		// 3. init & open files for output
+		ofstream	theBootFileStream;
+		string theBootFileName = mDataFilePath;
+		StringConcat (theBootFileName, kBootFileSuffix, kMaxFileNameLength);
+		AskProgressLog (theNumReplicates, theBootFileName);
+		theBootFileStream.open(theBootFileName.c_str());
+		if (not theBootFileStream)
+			throw FileOpenError (theBootFileName.c_str());
+					
+		// 4. actually do the work
+		ReportProgress("Resampling isolates");
+		mModel->CalcBootstrap (theNumReplicates, theConfidence / 100.0,
+			theBootFileStream);
+		
+		// 5. Tidy up and report finish
+		theBootFileStream.close ();
+		mProgressLog.Close();
+		cout << "Finished. Results saved in " << theBootFileName << "." << endl;
+	}
+	catch (...)
+	{
+		throw;	// Handled by ObeyCommand() now
+	}
+}
+
+
 void MultiLocusApp::CalcDiversity ()
 {
 	try
@@ -596,22 +819,31 @@ void MultiLocusApp::CalcDiversity ()
 		else
 			theNumRandomizations = 0;
 		bool	theSaveAsPaup = AskYesNoQuestion ("Save dataset to PAUP file");
-		cout << endl;
+		string theShardTag = AskShardSettings (theNumRandomizations,
+			not (theCalcPairwise or theSaveAsPaup));
 
-		// 2. init & open files for output
-		ReportProgress("Initialising output files");
-		
 		// create appropraiet stem name for files
 		string theBaseName (mDataFilePath);
 		sbl::stripExt (theBaseName);
+		StringConcat (theBaseName, theShardTag.c_str(),
+			kMaxFileNameLength - kMaxSuffixLength);
+		
+		// 1a. for long runs, offer to resume or checkpoint
+		Checkpoint		theResumePoint;
+		Checkpoint*		theResumePtr = AskCheckpointSettings (theNumRandomizations,
+			theBaseName, kAnalysis_Diversity, theCalcPairwise, theResumePoint);
+		AskProgressLog (theNumRandomizations, theBaseName);
+		cout << endl;
+
+		// 2. init & open files for output
+		ReportProgress("Initialising output files");
 		
 		// set up stats file & stream
 		ofstream	theStatsFileStream;
 		string theStatsFileName = theBaseName;
 		StringConcat (theStatsFileName, kStatFileSuffix, kMaxFileNameLength);
-		theStatsFileStream.open(theStatsFileName.c_str());
-		if (not theStatsFileStream)
-			throw FileOpenError (theStatsFileName.c_str());
+		OpenOutputFile (theStatsFileStream, theStatsFileName, theResumePtr,
+			kOutput_Stats);
 			
 		// set up paup file & stream
 		ofstream	thePaupFileStream;
@@ -620,9 +852,8 @@ void MultiLocusApp::CalcDiversity ()
 		{
 			thePaupFileName = theBaseName;
 			StringConcat (thePaupFileName, kPaupFileSuffix, kMaxFileNameLength);
-			thePaupFileStream.open(thePaupFileName.c_str());
-			if (not thePaupFileStream)
-				throw FileOpenError (thePaupFileName.c_str());
+			OpenOutputFile (thePaupFileStream, thePaupFileName, theResumePtr,
+				kOutput_Paup);
 		}
 		
 		// set up pairs file & stream
@@ -632,9 +863,8 @@ void MultiLocusApp::CalcDiversity ()
 		{
 			thePairsFileName = theBaseName;
 			StringConcat (thePairsFileName, kPairFileSuffix, kMaxFileNameLength);
-			thePairsFileStream.open (thePairsFileName.c_str());
-			if (not thePairsFileStream)
-				throw FileOpenError (thePairsFileName.c_str());
+			OpenOutputFile (thePairsFileStream, thePairsFileName, theResumePtr,
+				kOutput_Pairs);
 		}
 		
 		// 3. actually do the calculations
@@ -646,6 +876,7 @@ void MultiLocusApp::CalcDiversity ()
 		thePairsFileStream.close ();
 		theStatsFileStream.close ();
 		thePaupFileStream.close ();
+		mProgressLog.Close ();
 		cout << "Finished. Results saved in " << theStatsFileName;
 		if (theSaveAsPaup)
 		{
@@ -688,6 +919,8 @@ void MultiLocusApp::LoadDataFile ()
 			
 			// create new one
 			mModel = new MultiLocusModel;
+			mModel->AddObserver (&mConsoleProgress);
+			mModel->AddObserver (&mProgressLog);
 			
 			ifstream theDataFileStrm  (mDataFilePath.c_str());
 			if (theDataFileStrm)
@@ -872,6 +1105,8 @@ void MultiLocusApp::SetPrefs ()
 	theInclusionCmds.AddCommand (kCmd_ExcludeLoci, 'l', "Exclude loci with missing data");			
 	theInclusionCmds.AddCommand (kCmd_FixMissing, 'f', "Fix missing data during randomizations");			
 	theInclusionCmds.AddCommand (kCmd_FreeMissing, 'a', "Allow missing data to move during randomizations");			
+	theInclusionCmds.AddCommand (kCmd_SamplePairs, 's', "Estimate variances from a sample of isolate pairs");			
+	theInclusionCmds.AddCommand (kCmd_AllPairs, 'e', "Use every pair of isolates for variances");			
 	theInclusionCmds.AddCommand (kCmd_Return, 'r', "Return to main menu");			
 	theInclusionCmds.SetConvertShortcut (true);
 	
@@ -899,6 +1134,11 @@ void MultiLocusApp::SetPrefs ()
 				assert (mModel->mDoMissingShuffle == kMissing_Free);
 				theInclusionCmds.SetCommandActive (kCmd_FixMissing, true);
 			}
+			// sample pairs or not?
+			if (mModel->mPairSampleError == 0.0)
+				theInclusionCmds.SetCommandActive (kCmd_SamplePairs, true);
+			else
+				theInclusionCmds.SetCommandActive (kCmd_AllPairs, true);
 			// always true	
 			theInclusionCmds.SetCommandActive(kCmd_Return, true);
 				
@@ -934,6 +1174,25 @@ void MultiLocusApp::SetPrefs ()
 					cout << endl << "Missing data will now be fixed in position during randomization." << endl;
 					break;
 
+				case kCmd_SamplePairs:
+				{
+					float theError;
+					do
+					{
+						theError = AskFloatQuestion
+							("Standard error wanted, as a percentage of each variance");
+					}
+					while ((theError <= 0.0) or (100.0 <= theError));
+					mModel->mPairSampleError = theError / 100.0;
+					cout << endl << "Variances of distances will now be estimated from sampled pairs, where there are enough." << endl;
+					break;
+				}
+
+				case kCmd_AllPairs:
+					mModel->mPairSampleError = 0.0;
+					cout << endl << "Variances of distances will now use every pair of isolates." << endl;
+					break;
+
 				case kCmd_Return:
 					// do nothing
 					break;
@@ -954,6 +1213,127 @@ void MultiLocusApp::SetPrefs ()
 	while (theUserCmd != kCmd_Return);
 
 }
+
+
+// MERGE SHARDS
+// Put together the results of a randomization job that was split across
+// several runs. This needs no data loaded, as everything needed is in the
+// results files.
+void MultiLocusApp::MergeShards ()
+{
+	try
+	{
+		cout << endl;
+		
+		UInt theNumShards = AskIntWithMinQuestion ("Number of shards in the job", 2);
+		vector<string> theShardFileNames;
+		for (UInt i = 0; i < theNumShards; i++)
+		{
+			stringstream thePromptStrm;
+			thePromptStrm << "Results file for shard " << (i + 1);
+			theShardFileNames.push_back (AskStringQuestion
+				(thePromptStrm.str().c_str()));
+		}
+		string theMergedFileName = AskStringQuestion
+			("Name of file for the merged results");
+		
+		ReportProgress("Merging shards");
+		MergeShardResults (theShardFileNames, theMergedFileName.c_str());
+		cout << "Finished. Results saved in " << theMergedFileName << "." << endl;
+	}
+	catch (...)
+	{
+		throw;	// Handled by ObeyCommand() now
+	}
+}
+
+
+// *** INTERNALS *********************************************************/
+#pragma mark --
+
+// ASK SHARD SETTINGS
+// A long job can be split into shards, each done by a separate run of the
+// program. Every shard must be given the same seed, so that they draw
+// their replicates from the one random sequence. Returns the tag that
+// marks the shard's output files, which is empty for an unsplit run.
+// Only the statistics & theta of shards can be merged, so if other output
+// is asked for the run is not split & the question isn't asked.
+string MultiLocusApp::AskShardSettings (UInt iNumRandomizations,
+	bool iIsMergeable)
+{
+	mModel->mShardIndex = 0;
+	mModel->mNumShards = 1;
+	if ((iNumRandomizations == 0) or (not iIsMergeable))
+		return string ("");
+	if (not AskYesNoQuestion ("Run as one shard of a larger job"))
+		return string ("");
+	
+	mModel->mNumShards = AskIntWithBoundsQuestion ("Number of shards in the job",
+		2, iNumRandomizations);
+	mModel->mShardIndex = AskIntWithBoundsQuestion ("Which shard is this", 1,
+		mModel->mNumShards) - 1;
+	mModel->SetRunSeed (AskIntWithBoundsQuestion
+		("Seed for the job (the same for every shard)", 1, kMaxJobSeed));
+	
+	stringstream theTagStrm;
+	theTagStrm << ".s" << (mModel->mShardIndex + 1) << "of" << mModel->mNumShards;
+	return theTagStrm.str();
+}
+
+
+// ASK CHECKPOINT SETTINGS
+// For a long run, offer to resume from the checkpoint saved beside the
+// results, & to save checkpoints every so many randomizations. Returns
+// the checkpoint read into oResumePoint, or NULL if starting afresh. The
+// checkpoint is checked against the analysis, data & settings here, as
+// resuming cuts the results back to it.
+Checkpoint* MultiLocusApp::AskCheckpointSettings
+(UInt iNumRandomizations, const string& iResultsName, const char* iAnalysis,
+	bool iHasPairStats, Checkpoint& oResumePoint)
+{
+	string theCheckpointName = iResultsName;
+	StringConcat (theCheckpointName, kCheckpointSuffix, kMaxFileNameLength);
+	Checkpoint* theResumePtr = NULL;
+	mModel->mCheckpointStep = 0;
+	mModel->mCheckpointPath = theCheckpointName;
+	if (iNumRandomizations == 0)
+		return theResumePtr;
+	
+	if (Checkpoint::Exists (theCheckpointName.c_str()) and
+		AskYesNoQuestion ("Resume from the saved checkpoint"))
+	{
+		mModel->ReadCheckpoint (oResumePoint, iAnalysis, iNumRandomizations,
+			iHasPairStats);
+		theResumePtr = &oResumePoint;
+		mModel->mResumeFromCheckpoint = true;
+	}
+	if (AskYesNoQuestion ("Save checkpoints during randomizations"))
+	{
+		mModel->mCheckpointStep = AskIntWithMinQuestion
+			("Randomizations between checkpoints", 1);
+	}
+	return theResumePtr;
+}
+
+
+// ASK PROGRESS LOG
+// Offer to record the progress of randomizations for other programs to
+// read, as JSON, one report per line, in a file named after the results.
+void MultiLocusApp::AskProgressLog
+(UInt iNumRandomizations, const string& iBaseName)
+{
+	mProgressLog.Close ();
+	if ((iNumRandomizations == 0) or
+		not AskYesNoQuestion ("Log progress to a file"))
+		return;
+	
+	string theLogName = iBaseName;
+	StringConcat (theLogName, kProgressSuffix, kMaxFileNameLength);
+	mProgressLog.Open (theLogName.c_str());
+	cout << "Progress will be logged to " << theLogName << "." << endl;
+}
+
+
 // *** DEPRECIATED FUNCTIONS *********************************************/
 
 // *** END ***************************************************************/
@@ -32,6 +32,11 @@ To Do:
 #include "Combination.h"
 #include "ComboMill.h"
 #include "SblNumerics.h"
+#include "Checkpoint.h"
+#include "PloidyPolicy.h"
+#include "LocusDistanceBits.h"
+#include "BootstrapEngine.h"
+#include "PairDistArray.h"
 #include "Error.h"
 
 #include <cstring>
@@ -41,7 +46,9 @@ To Do:
 #include <iterator>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <iostream>
+#include <thread>
 
 using std::strlen;
 using std::string;
@@ -50,6 +57,7 @@ using std::find_if;
 using std::isalnum;
 using std::isdigit;
 using std::map;
+using std::unordered_map;
 using std::pair;
 using std::make_pair;
 using std::sqrt;
@@ -57,13 +65,19 @@ using std::ios;
 using std::setw;
 using std::swap;
 using std::find;
+using std::sort;
 using std::right;
 using std::endl;
 using std::cout;
+using std::remove;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::thread;
 using sbl::isMemberOf;
 using sbl::StrMember;
 using sbl::String2Int;
 using sbl::StringConcat;
+using sbl::toString;
 
 
 // *** CONSTANTS & DEFINES
@@ -87,10 +101,176 @@ enum pval_t
 };
 
 const int kRandomProgressStep = 10; // To Do: too big? too small?
+const UInt kNoProgressDue = ~UInt (0);	// when no run is going
 
 const bool kRandomData	= false;
 const bool kOriginalData = true;
 
+const long kMaxSeed = 2147483647L;	// the generator uses 31 bits
+
+// past one swap for this many cells of data, undoing the swaps of a
+// replicate costs more than copying the saved data back
+const UInt kCellsPerJournalSwap = 8;
+
+// the pairs of isolates sampled for estimating the variance of distances
+// come from a stream of their own, started the same way every time, and
+// the sample starts at this size & doubles
+const long kPairSampleSeed = 1;
+const UInt kFirstPairSample = 4096;
+
+// single-character symbols for diplotypes in PAUP output, past which each
+// is written as a token
+const char	kDTypeSymbols[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+const UInt	kNumDTypeSymbols = sizeof (kDTypeSymbols) - 1;
+
+// the indices of all loci or isolates, for kernels that work on a selection
+static vector<UInt> AllIndices (UInt iNumIndices)
+{
+	vector<UInt> theIndices (iNumIndices);
+	for (UInt i = 0; i < iNumIndices; i++)
+		theIndices[i] = i;
+	return theIndices;
+}
+
+// the sums of distances & their squares over every pair of isolates, from
+// the class of each isolate & the distances between classes, by counting
+// the pairs of each two classes. The sums are doubles, as their squares
+// are taken & for many isolates would not fit a long.
+static void ClassDistanceMoments (const vector<UInt>& iClasses,
+	UInt iNumClasses, const vector<uchar>& iDists, double& oSumDist,
+	double& oSumSquares)
+{
+	vector<long> theCounts (iNumClasses, 0);
+	for (UInt i = 0; i < iClasses.size(); i++)
+		theCounts[iClasses[i]]++;
+	
+	oSumDist = oSumSquares = 0;
+	for (UInt a = 0; a < iNumClasses; a++)
+	{
+		if (theCounts[a] == 0)
+			continue;
+		for (UInt b = a; b < iNumClasses; b++)
+		{
+			long theNumPairs = (a == b) ? (theCounts[a] * (theCounts[a] - 1)) / 2 :
+				theCounts[a] * theCounts[b];
+			long theDist = iDists[(a * iNumClasses) + b];
+			oSumDist += double (theNumPairs * theDist);
+			oSumSquares += double (theNumPairs * theDist * theDist);
+		}
+	}
+}
+
+// whether the distinct genotypes at a pair of sites, as pairs of allele
+// numbers, are all compatible, by growing a lattice from each in turn as
+// MultiLocusModel::CalcPorpCompat() does. The genotypes are used up.
+static bool AreGenotypesCompatible (vector< pair<UInt,UInt> >& ioGenotypes)
+{
+	vector< pair<UInt,UInt> > theGraph;
+	while (ioGenotypes.size() != 0)
+	{
+		theGraph.assign (1, ioGenotypes.back());
+		ioGenotypes.pop_back ();
+		for (int k = 0; k < (int) ioGenotypes.size(); k++)
+		{
+			bool isGtype1Unique = true;
+			bool isGtype2Unique = true;
+			for (UInt m = 0; m < theGraph.size(); m++)
+			{
+				if (ioGenotypes[k].first == theGraph[m].first)
+					isGtype1Unique = false;
+				if (ioGenotypes[k].second == theGraph[m].second)
+					isGtype2Unique = false;
+			}
+			
+			if ((not isGtype1Unique) and (not isGtype2Unique))
+				return false;
+			if (isGtype1Unique != isGtype2Unique)
+			{
+				// grow the lattice & start looking again from the beginning
+				theGraph.push_back (ioGenotypes[k]);
+				ioGenotypes.erase (ioGenotypes.begin() + k);
+				k = -1;
+			}
+		}
+	}
+	return true;
+}
+
+// the index of association & rBarD by contrasting the observed variance of
+// distances with that expected, as in MultiLocusModel::CalcIndexAssocRBarD()
+static void IndexAssocFromVar (double iVarDistObs, double iSumVarDist,
+	double iMaxSumCov, double& oIndexAssoc, double& oRBarD)
+{
+	oIndexAssoc = (iVarDistObs / iSumVarDist) - 1.0;
+	oRBarD = (iVarDistObs - iSumVarDist) / (2 * iMaxSumCov);
+}
+
+// the index of association & rBarD from the summed distances between
+// isolates over some loci, and the expected variance & maximum covariance
+// of those loci
+static void IndexAssocFromMoments (double iNumPairs, double iSumDist,
+	double iSumDistSq, double iSumVarDist, double iMaxSumCov,
+	double& oIndexAssoc, double& oRBarD)
+{
+	double theVarDistObs = (iSumDistSq - iSumDist / iNumPairs * iSumDist) /
+		iNumPairs;
+	IndexAssocFromVar (theVarDistObs, iSumVarDist, iMaxSumCov, oIndexAssoc,
+		oRBarD);
+}
+
+static void IndexAssocFromDist (const vector<int>& iDistArray,
+	double iSumVarDist, double iMaxSumCov, double& oIndexAssoc, double& oRBarD)
+{
+	double theSumDist = 0, theSumDistSq = 0;
+	for (UInt i = 0; i < iDistArray.size(); i++)
+	{
+		theSumDist += iDistArray[i];
+		theSumDistSq += iDistArray[i] * iDistArray[i];
+	}
+	IndexAssocFromMoments (double (iDistArray.size()), theSumDist, theSumDistSq,
+		iSumVarDist, iMaxSumCov, oIndexAssoc, oRBarD);
+}
+
+// the same from distances held narrow
+static void IndexAssocFromDist (const PairDistArray& iDists,
+	double iSumVarDist, double iMaxSumCov, double& oIndexAssoc, double& oRBarD)
+{
+	double theSumDist, theSumDistSq;
+	iDists.CalcMoments (theSumDist, theSumDistSq);
+	IndexAssocFromMoments (double (iDists.size()), theSumDist, theSumDistSq,
+		iSumVarDist, iMaxSumCov, oIndexAssoc, oRBarD);
+}
+
+// the maximum sum of covariances, sum (sqrt (var1 * var2)) over pairs of
+// the loci from iFirst up to iLast, bar iSkip. Each locus is taken with all
+// those after it at once, so that if only one locus varies there is no
+// covariance, exactly.
+static double SumMaxCovariance (const vector<double>& iVarDist, UInt iFirst,
+	UInt iLast, UInt iSkip)
+{
+	double theMaxSumCov = 0.0, theSumSqrtVar = 0.0;
+	for (UInt j = iLast; iFirst < j; j--)
+	{
+		if (j - 1 == iSkip)
+			continue;
+		double theSqrtVar = sqrt (iVarDist[j - 1]);
+		theMaxSumCov += theSqrtVar * theSumSqrtVar;
+		theSumSqrtVar += theSqrtVar;
+	}
+	return theMaxSumCov;
+}
+
+// names of the analyses, noted in checkpoints & progress reports
+const char* kAnalysis_Diversity		= "diversity";
+const char* kAnalysis_Theta			= "theta";
+const char* kAnalysis_ThetaChoice	= "theta-choice";
+const char* kAnalysis_Partitions		= "partitions";
+const char* kAnalysis_PlotDiv			= "plot-div";
+const char* kAnalysis_Windows			= "windows";
+const char* kAnalysis_Jackknife		= "jackknife";
+const char* kAnalysis_Bootstrap		= "bootstrap";
+
 const char* kSymbol_Unknown 	= "?";
 const char* kSymbol_Gap 		= "-";
 
@@ -103,30 +283,31 @@ const char* kSymbol_Gap 		= "-";
 
 MultiLocusModel::MultiLocusModel ()
 {
-	// never trust an uninitialised pointer
-	mDiploData = mBackupDiploData = mOriginalDiploData = NULL;
-	mHaploData = mBackupHaploData = mOriginalHaploData = NULL;
 	// see default states
 	mPloidy = kPloidy_None;
+	mHasBackup = mIsJournalFull = false;
+	mJournalLimit = 0;
+	mIsGtypeStatsKnown = mHasGtypeStats = false;
 	mExcludeLoci = mExcludeIso = false;
 	mIsDataRankable = true; 
 	mDoMissingShuffle = kMissing_Free;
+	mCheckpointStep = 0;
+	mResumeFromCheckpoint = false;
+	mShardIndex = 0;
+	mNumShards = 1;
+	mEngine = kEngine_Fast;
+	mNumThreads = std::max (thread::hardware_concurrency(), 1U);
+	mPairSampleError = 0.0;
+	mIndexAssocError = mRBarDError = 0.0;
+	mRunSeed = mRng.UniformWhole (1, kMaxSeed - 1);
+	mRunSeedGiven = false;
+	mNextProgressRep = kNoProgressDue;
+	mProgressStep = kRandomProgressStep;
 }
 
+// CHANGE: the data matrices are members & free themselves
 MultiLocusModel::~MultiLocusModel ()
 {
-//	if (mDiploData)
-		delete mDiploData;
-//	if (mHaploData)
-		delete mHaploData;
-//	if (mBackupDiploData)
-		delete mBackupDiploData;
-//	if (mBackupHaploData)
-		delete mBackupHaploData;
-		delete mOriginalDiploData;
-		delete mOriginalHaploData;
-	mDiploData = mBackupDiploData = mOriginalDiploData = NULL;
-	mHaploData = mBackupHaploData = mOriginalHaploData = NULL;
 }
 
 
@@ -136,18 +317,18 @@ MultiLocusModel::~MultiLocusModel ()
 UInt MultiLocusModel::GetNumRows ()
 {
 	if (GetPloidy() == kPloidy_Haploid)
-		return mHaploData->size();
+		return mHaploData.GetNumRows();
 	else
-		return mDiploData->size();
+		return mDiploData.GetNumRows();
 }
 
 
 UInt MultiLocusModel::GetNumCols ()
 {
 	if (GetPloidy() == kPloidy_Haploid)
-		return (*mHaploData)[0].size();
+		return mHaploData.GetNumCols();
 	else
-		return (*mDiploData)[0].size();
+		return mDiploData.GetNumCols();
 }
 
 
@@ -159,14 +340,14 @@ ploidy_t MultiLocusModel::GetPloidy ()
 	switch (mPloidy)
 	{
 		case kPloidy_Haploid:
-			assert ((mHaploData != NULL) and (mDiploData == NULL));
+			assert (mDiploData.empty());
 			// assert (mOriginalDiploData == NULL);
 			// CHANGE: cannot make this check because this is called from
 			// BackupOriginal() before it finishes creating the Original
 			break;
 
 		case kPloidy_Diploid:
-			assert ((mHaploData == NULL) and (mDiploData != NULL));
+			assert (mHaploData.empty());
 			// assert (mOriginalDiploData != NULL);
 			// CHANGE: as above
 			break;
@@ -186,12 +367,12 @@ const char* MultiLocusModel::GetDataString (UInt iRowIndex, UInt iColIndex)
 	switch (GetPloidy())
 	{
 		case kPloidy_Haploid:
-			return ((*mHaploData)[iRowIndex][iColIndex]).c_str();
+			return (mHaploData[iRowIndex][iColIndex]).c_str();
 			break;
 	 
 		case kPloidy_Diploid:
-			theReturnStr = (*mDiploData)[iRowIndex][iColIndex].alleleA + '/';
-			theReturnStr +=(* mDiploData)[iRowIndex][iColIndex].alleleB;
+			theReturnStr = mDiploData[iRowIndex][iColIndex].alleleA + '/';
+			theReturnStr +=mDiploData[iRowIndex][iColIndex].alleleB;
 			return theReturnStr.c_str();
 			break;	
 			
@@ -205,6 +386,29 @@ const char* MultiLocusModel::GetDataString (UInt iRowIndex, UInt iColIndex)
 }
 
 
+long MultiLocusModel::GetRunSeed ()
+{
+	return mRunSeed;
+}
+
+
+// SET RUN SEED
+// Fix the seed for the next randomization run, as every shard of a job
+// must have the same one. Otherwise each run picks a new seed.
+void MultiLocusModel::SetRunSeed (long iSeed)
+{
+	assert ((0 < iSeed) and (iSeed < kMaxSeed));
+	mRunSeed = iSeed;
+	mRunSeedGiven = true;
+}
+
+
+bool MultiLocusModel::IsSharded ()
+{
+	return (1 < mNumShards);
+}
+
+
 // *** LOADING ***********************************************************/
 #pragma mark --
 
@@ -215,6 +419,15 @@ const char* MultiLocusModel::GetDataString (UInt iRowIndex, UInt iColIndex)
 void MultiLocusModel::
 ParseInput (ifstream& ioInputFile, const char* iDataFileName)
 {
+	mProfile.Clear ();
+	ScopedPhase thePhase (mProfile, kPhase_Parse);
+	// CHANGE: any data read before is let go, so a model can be reused
+	mHaploData.clear ();
+	mDiploData.clear ();
+	mBackupHaploData.clear ();
+	mBackupDiploData.clear ();
+	mOriginalHaploData.clear ();
+	mOriginalDiploData.clear ();
 	// configure scanner
 	StreamScanner	theScanner (ioInputFile);
 	theScanner.SetComments ("", "");
@@ -262,7 +475,6 @@ void
 MultiLocusModel::ParseHaploidInput (StreamScanner& iScanner, UInt iNumCols)
 {
 	mPloidy = kPloidy_Haploid;
-	mHaploData = new MATRIX(tAllele);
 	int theNumRows = 0;
 	
 	// while the eof has not been reached
@@ -311,10 +523,10 @@ MultiLocusModel::ParseHaploidInput (StreamScanner& iScanner, UInt iNumCols)
 		theCurrAllele = theInToken;
 		theDataRow.push_back (theCurrAllele);
 	
-		mHaploData->push_back (theDataRow);
+		mHaploData.AddRow (theDataRow);
 	}
 	
-	assert ((int) mHaploData->size() == theNumRows);
+	assert ((int) mHaploData.size() == theNumRows);
 }
 
 
@@ -322,7 +534,6 @@ void
 MultiLocusModel::ParseDiploidInput (StreamScanner& iScanner, UInt iNumCols)
 {
 	mPloidy = kPloidy_Diploid;
-	mDiploData = new MATRIX(tAllelePair);
 	int theNumRows = 0;
 	
 	// while the eof has not been reached
@@ -345,6 +556,7 @@ MultiLocusModel::ParseDiploidInput (StreamScanner& iScanner, UInt iNumCols)
 		// for each line
 		theNumRows++;
 		theCurrAllele.transNumDTypes = 0;
+		theCurrAllele.dtypeId = 0;
 		
 		for (int i = 0; i < int (iNumCols - 1); i++)
 		{
@@ -392,11 +604,11 @@ MultiLocusModel::ParseDiploidInput (StreamScanner& iScanner, UInt iNumCols)
 		// store allele pair
 		theDataRow.push_back (theCurrAllele);
 	
-		mDiploData->push_back (theDataRow);
+		mDiploData.AddRow (theDataRow);
 	}
 	
 	
-	assert ((int) mDiploData->size() == theNumRows);
+	assert ((int) mDiploData.size() == theNumRows);
 }
 
 
@@ -448,29 +660,27 @@ bool IsNotDigit (char& iChar)
 #pragma mark --
 
 // BACKUP DATASET
-// MAkes a copy of the dataset in the backup slot, deletes any that was 
+// MAkes a copy of the dataset in the backup slot, replacing any that was 
 // previously left there
+// CHANGE: the matrices are kept by value, so a copy is a single block
+// & the old backup goes with it. The swaps made from here on are noted
+// (see RestoreWorkingData()).
 void MultiLocusModel::BackupWorkingData ()
 {
+	ScopedPhase thePhase (mProfile, kPhase_BackupRestore);
 	// preconditions: only 1 data slot should have data and at most
 	// only one backup slot should have data.
-	assert ((mHaploData != NULL) or (mDiploData != NULL));
-	assert ((mBackupHaploData == NULL) or (mBackupDiploData == NULL));
+	assert ((not mHaploData.empty()) or (not mDiploData.empty()));
+	assert (mBackupHaploData.empty() or mBackupDiploData.empty());
 	
 	switch (GetPloidy())
 	{
 		case kPloidy_Haploid:
-			if (mBackupHaploData != NULL)
-				delete mBackupHaploData;
-			mBackupHaploData = new MATRIX(tAllele);
-			*mBackupHaploData = *mHaploData;
+			mBackupHaploData = mHaploData;
 			break;
 			
 		case kPloidy_Diploid:
-			if (mBackupDiploData != NULL)
-				delete mBackupDiploData;
-			mBackupDiploData = new MATRIX(tAllelePair);
-			*mBackupDiploData = *mDiploData;
+			mBackupDiploData = mDiploData;
 			break;
 			
 		default:
@@ -478,30 +688,52 @@ void MultiLocusModel::BackupWorkingData ()
 			assert (false);
 			break;
 	}
+	
+	mBackupRanks = mRanks;
+	mBackupIsoRankSums = mIsoRankSums;
+	mBackupLocusCodes = mLocusCodes;
+	mBackupIsCellMissing = mIsCellMissing;
+	mBackupNumIsoMissing = mNumIsoMissing;
+	
+	mHasBackup = true;
+	mIsJournalFull = false;
+	mSwapJournal.clear ();
+	mJournalLimit = 3 * ((GetNumRows() * GetNumCols()) / kCellsPerJournalSwap);
+	mSwapJournal.reserve (mJournalLimit);
 }
 
 
+// RESTORE DATASET
+// CHANGE: the data is restored once per replicate, so where a replicate
+// swapped few alleles, they are swapped back, last first, rather than
+// all the data copied. Only if the swaps outgrew the journal is the
+// backup copied.
 void MultiLocusModel::RestoreWorkingData ()
 {
+	ScopedPhase thePhase (mProfile, kPhase_BackupRestore);
 	// preconditions: only 1 data slot should have data and at most
 	// only one backup slot should have data.
-	assert ((mHaploData != NULL) or (mDiploData != NULL));
-	assert ((mBackupHaploData != NULL) or (mBackupDiploData != NULL));
+	assert ((not mHaploData.empty()) or (not mDiploData.empty()));
+	assert ((not mBackupHaploData.empty()) or (not mBackupDiploData.empty()));
+	assert (mHasBackup);
+	
+	if (not mIsJournalFull)
+	{
+		for (UInt k = mSwapJournal.size(); 0 < k; k -= 3)
+			ExchangeAlleles (mSwapJournal[k - 3], mSwapJournal[k - 2],
+				mSwapJournal[k - 1]);
+		mSwapJournal.clear ();
+		return;
+	}
 	
 	switch (GetPloidy())
 	{
 		case kPloidy_Haploid:
-			assert (mHaploData != NULL);
-			delete mHaploData;
-			mHaploData = new MATRIX(tAllele);
-			*mHaploData = *mBackupHaploData;
+			mHaploData = mBackupHaploData;
 			break;
 			
 		case kPloidy_Diploid:
-			assert (mDiploData != NULL);
-			delete mDiploData;
-			mDiploData = new MATRIX(tAllelePair);
-			*mDiploData = *mBackupDiploData;
+			mDiploData = mBackupDiploData;
 			break;
 			
 		default:
@@ -509,6 +741,15 @@ void MultiLocusModel::RestoreWorkingData ()
 			assert (false);
 			break;
 	}
+	
+	mRanks = mBackupRanks;
+	mIsoRankSums = mBackupIsoRankSums;
+	mLocusCodes = mBackupLocusCodes;
+	mIsCellMissing = mBackupIsCellMissing;
+	mNumIsoMissing = mBackupNumIsoMissing;
+	
+	mIsJournalFull = false;
+	mIsGtypeStatsKnown = false;
 }
 
 
@@ -519,22 +760,18 @@ void MultiLocusModel::BackupOriginal ()
 {
 	// preconditions: only one dataset, no backup of the original has occured
 	// before.
-	assert ((mHaploData == NULL) or (mDiploData == NULL));
-	assert ((mHaploData != NULL) or (mDiploData != NULL));
-	assert ((mOriginalHaploData == NULL) and (mOriginalDiploData == NULL));
+	assert (mHaploData.empty() or mDiploData.empty());
+	assert ((not mHaploData.empty()) or (not mDiploData.empty()));
+	assert (mOriginalHaploData.empty() and mOriginalDiploData.empty());
 	
 	switch (GetPloidy())
 	{
 		case kPloidy_Haploid:
-			assert (mHaploData != NULL);
-			mOriginalHaploData = new MATRIX(tAllele);
-			*mOriginalHaploData = *mHaploData;
+			mOriginalHaploData = mHaploData;
 			break;
 			
 		case kPloidy_Diploid:
-			assert (mDiploData != NULL);
-			mOriginalDiploData = new MATRIX(tAllelePair);
-			*mOriginalDiploData = *mDiploData;
+			mOriginalDiploData = mDiploData;
 			break;
 			
 		default:
@@ -542,33 +779,57 @@ void MultiLocusModel::BackupOriginal ()
 			assert (false);
 			break;
 	}
+	
+	mIsIsoIncluded.assign (GetNumRows(), true);
+	mIsLocusIncluded.assign (GetNumCols(), true);
 }
 
 // RESTORE ORIGINAL
 // For when the user decides to "include all" and the original dataset
 // must be restored. This is only called in that circumstance. 
+// CHANGE: by including every isolate & locus again.
 void MultiLocusModel::RestoreOriginal ()
 {
 	// preconditions: only 1 data slot and 1 backup slot should have data
-	assert ((mHaploData == NULL) or (mDiploData == NULL));
-	assert ((mHaploData != NULL) or (mDiploData != NULL));
-	assert ((mOriginalHaploData == NULL) or (mOriginalDiploData == NULL));
-	assert ((mOriginalHaploData != NULL) or (mOriginalDiploData != NULL));
+	assert (mHaploData.empty() or mDiploData.empty());
+	assert ((not mHaploData.empty()) or (not mDiploData.empty()));
+	assert (mOriginalHaploData.empty() or mOriginalDiploData.empty());
+	assert ((not mOriginalHaploData.empty()) or
+		(not mOriginalDiploData.empty()));
+	
+	mIsIsoIncluded.assign (mIsIsoIncluded.size(), true);
+	mIsLocusIncluded.assign (mIsLocusIncluded.size(), true);
+	ApplyInclusion ();
+}
+
+
+// APPLY INCLUSION
+// Draw the current data from the original, by the isolates & loci
+// included. Every cell is copied once, however many are left out.
+void MultiLocusModel::ApplyInclusion ()
+{
+	bool theIsAllIncluded =
+		(find (mIsIsoIncluded.begin(), mIsIsoIncluded.end(), false) ==
+			mIsIsoIncluded.end()) and
+		(find (mIsLocusIncluded.begin(), mIsLocusIncluded.end(), false) ==
+			mIsLocusIncluded.end());
 	
 	switch (GetPloidy())
 	{
 		case kPloidy_Haploid:
-			assert (mHaploData != NULL);
-			delete mHaploData;
-			mHaploData = new MATRIX(tAllele);
-			*mHaploData = *mOriginalHaploData;
+			if (theIsAllIncluded)
+				mHaploData = mOriginalHaploData;
+			else
+				mHaploData.CopySelected (mOriginalHaploData, mIsIsoIncluded,
+					mIsLocusIncluded);
 			break;
 			
 		case kPloidy_Diploid:
-			assert (mDiploData != NULL);
-			delete mDiploData;
-			mDiploData = new MATRIX(tAllelePair);
-			*mDiploData = *mOriginalDiploData;
+			if (theIsAllIncluded)
+				mDiploData = mOriginalDiploData;
+			else
+				mDiploData.CopySelected (mOriginalDiploData, mIsIsoIncluded,
+					mIsLocusIncluded);
 			break;
 			
 		default:
@@ -595,9 +856,53 @@ void MultiLocusModel::DetermineDimensions ()
 	mPops.SetNumElements (theNumRows);
 	mPops.MergeAll ();
 	mNumPairsSites = theNumCols * (theNumCols - 1) / 2;
-	mNumPairsIsolates = theNumRows * (theNumRows - 1) / 2;
+	mNumPairsIsolates = (ulong (theNumRows) * ulong (theNumRows - 1)) / 2;
 	
 	mIsDataRankable = IsDataRankable ();
+	InitRanks ();
+	
+	// CHANGE: the diplotypes of each locus are numbered for the fast engine
+	if (GetPloidy() == kPloidy_Diploid)
+		InitLocusDTypes ();
+	InitLocusCodes ();
+	InitMissing ();
+	
+	// CHANGE: undoing the swaps made before would not take the data back
+	// to how it is now, so they are forgotten
+	mHasBackup = mIsJournalFull = false;
+	mSwapJournal.clear ();
+	mIsGtypeStatsKnown = false;
+}
+
+
+// INIT RANKS
+// Parse the ranks of the alleles once, rather than for every rBarS. As in
+// the reference calculation, a missing allele ranks as 0 & those of a
+// diploid pair are added.
+void MultiLocusModel::InitRanks ()
+{
+	mRanks.clear();
+	mIsoRankSums.clear();
+	if (not mIsDataRankable)
+		return;
+	
+	UInt theNumLoci = GetNumCols();
+	mRanks.resize (GetNumRows() * theNumLoci);
+	mIsoRankSums.resize (GetNumRows(), 0);
+	for (UInt k = 0; k < GetNumRows(); k++)
+	{
+		for (UInt i = 0; i < theNumLoci; i++)
+		{
+			int theRank;
+			if (GetPloidy() == kPloidy_Haploid)
+				theRank = String2Int (mHaploData[k][i]);
+			else
+				theRank = String2Int (mDiploData[k][i].alleleA)
+					+ String2Int (mDiploData[k][i].alleleB);
+			mRanks[(k * theNumLoci) + i] = theRank;
+			mIsoRankSums[k] += theRank;
+		}
+	}
 }
 
 
@@ -610,14 +915,14 @@ bool MultiLocusModel::IsDataRankable ()
 		{
 			if (GetPloidy() == kPloidy_Haploid)
 			{
-				if (not IsAlleleRankable ((*mHaploData)[i][j]))
+				if (not IsAlleleRankable (mHaploData[i][j]))
 					return false;
 			}
 			else
 			{
-				if (not IsAlleleRankable ((*mDiploData)[i][j].alleleA))
+				if (not IsAlleleRankable (mDiploData[i][j].alleleA))
 					return false;
-				if (not IsAlleleRankable ((*mDiploData)[i][j].alleleB))
+				if (not IsAlleleRankable (mDiploData[i][j].alleleB))
 					return false;
 			}
 		}
@@ -640,24 +945,27 @@ void MultiLocusModel::IncludeAllData ()
 
 // Return false if it is not possible to exclude isolates as
 // this would leave an empty dataset.
+// CHANGE: the isolates missing data are left out of the original all at
+// once, rather than deleted one by one.
 bool MultiLocusModel::ExcludeMissingIso ()
 {
 	// check it will not exclude all data
 	if (IsRowMissing ())
 		return false;
 	
-	// collect the indexes of "missing" rows
-	vector <int>	theDeadRows;	
-	for (int i = 0; i < (int) GetNumRows(); i++)
+	// the current isolates are those still included, in order
+	UInt theIsoIndex = 0;
+	for (UInt i = 0; i < mIsIsoIncluded.size(); i++)
 	{
-		if (IsRowMissing (i))
-			theDeadRows.push_back (i);
+		if (mIsIsoIncluded[i])
+		{
+			if (IsRowMissing (theIsoIndex))
+				mIsIsoIncluded[i] = false;
+			theIsoIndex++;
+		}
 	}
 	
-	// delete the marked ones & adjust parameters
-	for (int i = (theDeadRows.size() - 1); 0 <= i; i--)
-		DeleteRow (theDeadRows[i]);
-	DetermineDimensions ();
+	ApplyInclusion ();
 	mExcludeIso = true;
 	
 	// return sucess
@@ -667,24 +975,25 @@ bool MultiLocusModel::ExcludeMissingIso ()
 
 // Return false if it is not possible to exclude loci as
 // this would leave an empty dataset.
+// CHANGE: as for isolates.
 bool MultiLocusModel::ExcludeMissingLoci ()
 {
 	// check it will not exclude all data
 	if (IsColMissing ())
 		return false;
 	
-	// collect the indexes of "missing" columns
-	vector <int>	theDeadCols;	
-	for (int i = 0; i < (int) GetNumCols(); i++)
+	UInt theLocusIndex = 0;
+	for (UInt i = 0; i < mIsLocusIncluded.size(); i++)
 	{
-		if (IsColMissing (i))
-			theDeadCols.push_back (i);
+		if (mIsLocusIncluded[i])
+		{
+			if (IsColMissing (theLocusIndex))
+				mIsLocusIncluded[i] = false;
+			theLocusIndex++;
+		}
 	}
 	
-	// delete the marked ones & adjust parameters
-	for (int i = (theDeadCols.size() - 1); 0 <= i; i--)
-		DeleteCol (theDeadCols[i]);
-	DetermineDimensions ();
+	ApplyInclusion ();
 	mExcludeLoci = true;
 	
 	// return sucess
@@ -692,26 +1001,6 @@ bool MultiLocusModel::ExcludeMissingLoci ()
 }
 
 
-void MultiLocusModel::DeleteCol (UInt iColIndex)
-{
-	for (int i = 0; i < (int) GetNumRows(); i++)
-	{
-		if (GetPloidy() == kPloidy_Haploid)
-			(*mHaploData)[i].erase ((*mHaploData)[i].begin() + iColIndex);
-		else
-			(*mDiploData)[i].erase ((*mDiploData)[i].begin() + iColIndex);
-	}
-}
-
-void MultiLocusModel::DeleteRow (UInt iRowIndex)
-{
-	if (GetPloidy() == kPloidy_Haploid)
-		mHaploData->erase (mHaploData->begin() + iRowIndex);
-	else
-		mDiploData->erase (mDiploData->begin() + iRowIndex);
-}
-
-
 // *** SHUFFLING OPS *****************************************************/
 #pragma mark --
 
@@ -720,6 +1009,7 @@ void MultiLocusModel::DeleteRow (UInt iRowIndex)
 // the individual populations. 
 void MultiLocusModel::ShuffleDataset ()
 {
+	ScopedPhase thePhase (mProfile, kPhase_Shuffle);
 	for (int i = 0; i < mPops.GetNumParts (); i++)
 	{
 		int theFromIndex, theToIndex;
@@ -797,20 +1087,229 @@ void MultiLocusModel::SwapAllele (int iAllelePosn, int iFromIso, int iToIso)
 		
 	// ... but if missing data is not fixed in place or neither allele
 	// is missing, just to a normal swap.
+	// CHANGE: noted, so that it can be undone (see RestoreWorkingData())
+	if (mHasBackup and (not mIsJournalFull))
+	{
+		if (mSwapJournal.size() == mJournalLimit)
+		{
+			mIsJournalFull = true;
+			mSwapJournal.clear ();
+		}
+		else
+		{
+			mSwapJournal.push_back (iAllelePosn);
+			mSwapJournal.push_back (iFromIso);
+			mSwapJournal.push_back (iToIso);
+		}
+	}
+	ExchangeAlleles (iAllelePosn, iFromIso, iToIso);
+}
+
+
+// EXCHANGE ALLELES
+// Swap the alleles of two isolates at a locus, whether missing or not.
+// CHANGE: the locus codes, the missing cells & the ranks for rBarS move
+// with the alleles
+void MultiLocusModel::ExchangeAlleles (UInt iLocus, UInt iIso1, UInt iIso2)
+{
 	if (GetPloidy() == kPloidy_Diploid)
 	{
-		tAllelePair	theSwapData = (*mDiploData) [iFromIso][iAllelePosn];
-		(*mDiploData) [iFromIso][iAllelePosn] = (*mDiploData) [iToIso][iAllelePosn];
-		(*mDiploData) [iToIso][iAllelePosn] = theSwapData;
+		tAllelePair	theSwapData = mDiploData[iIso1][iLocus];
+		mDiploData[iIso1][iLocus] = mDiploData[iIso2][iLocus];
+		mDiploData[iIso2][iLocus] = theSwapData;
 	}
 	else
 	{
 		assert (GetPloidy() == kPloidy_Haploid);
 		
-		tAllele	theSwapData = (*mHaploData) [iFromIso][iAllelePosn];
-		(*mHaploData) [iFromIso][iAllelePosn] = (*mHaploData) [iToIso][iAllelePosn];
-		(*mHaploData) [iToIso][iAllelePosn] = theSwapData;
+		tAllele	theSwapData = mHaploData[iIso1][iLocus];
+		mHaploData[iIso1][iLocus] = mHaploData[iIso2][iLocus];
+		mHaploData[iIso2][iLocus] = theSwapData;
+	}
+	
+	UInt theNumIso = GetNumRows();
+	mIsGtypeStatsKnown = false;
+	swap (mLocusCodes[(iLocus * theNumIso) + iIso1],
+		mLocusCodes[(iLocus * theNumIso) + iIso2]);
+	bool theIsMissing1 = mIsCellMissing[(iLocus * theNumIso) + iIso1];
+	bool theIsMissing2 = mIsCellMissing[(iLocus * theNumIso) + iIso2];
+	if (theIsMissing1 != theIsMissing2)
+	{
+		mIsCellMissing[(iLocus * theNumIso) + iIso1] = theIsMissing2;
+		mIsCellMissing[(iLocus * theNumIso) + iIso2] = theIsMissing1;
+		if (theIsMissing1)
+		{
+			mNumIsoMissing[iIso1]--;
+			mNumIsoMissing[iIso2]++;
+		}
+		else
+		{
+			mNumIsoMissing[iIso1]++;
+			mNumIsoMissing[iIso2]--;
+		}
+	}
+	if (not mRanks.empty())
+	{
+		UInt theNumLoci = GetNumCols();
+		int& theRank1 = mRanks[(iIso1 * theNumLoci) + iLocus];
+		int& theRank2 = mRanks[(iIso2 * theNumLoci) + iLocus];
+		mIsoRankSums[iIso1] += theRank2 - theRank1;
+		mIsoRankSums[iIso2] += theRank1 - theRank2;
+		swap (theRank1, theRank2);
+	}
+}
+
+
+// *** REPLICATES & CHECKPOINTS ******************************************/
+#pragma mark --
+
+// REPLICATE SEED
+// Every randomization reseeds the generator from the run seed and its
+// own number, so that replicate i is the same whether the run is done
+// straight through or resumed from a checkpoint. The mixing is the
+// "splitmix" finaliser, folded down to the 31 bits the generator uses.
+long ReplicateSeed (long iRunSeed, UInt iRepNum)
+{
+	unsigned long long theMix = (unsigned long long) iRunSeed;
+	theMix += 0x9E3779B97F4A7C15ULL * ((unsigned long long) iRepNum + 1);
+	theMix = (theMix ^ (theMix >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	theMix = (theMix ^ (theMix >> 27)) * 0x94D049BB133111EBULL;
+	theMix ^= (theMix >> 31);
+	return long (theMix % (unsigned long long) (kMaxSeed - 1)) + 1;
+}
+
+
+void MultiLocusModel::SeedReplicate (UInt iRepNum)
+{
+	mRng.SetSeed (ReplicateSeed (mRunSeed, iRepNum));
+}
+
+
+// CHOOSE RUN SEED
+// A seed set by the caller is used for one run only.
+void MultiLocusModel::ChooseRunSeed ()
+{
+	if (not mRunSeedGiven)
+		mRunSeed = mRng.UniformWhole (1, kMaxSeed - 1);
+	mRunSeedGiven = false;
+}
+
+
+// READ CHECKPOINT
+// Read the saved checkpoint & check that it belongs to this analysis,
+// dataset, number of randomizations & shard, and holds the statistics the
+// analysis will pick up. The app calls this before opening (& so cutting
+// back) any results, so a checkpoint that doesn't match costs nothing.
+void MultiLocusModel::ReadCheckpoint (Checkpoint& oCheckpoint,
+	const char* iAnalysis, UInt iNumRandomizations, bool iHasPairStats)
+{
+	UInt theNumStats = (string (iAnalysis) == kAnalysis_Diversity) ?
+		UInt (kPval_Size) : 1;
+	oCheckpoint.Read (mCheckpointPath.c_str(), theNumStats);
+	if ((oCheckpoint.mAnalysis != iAnalysis) or
+		(oCheckpoint.mDataName != mDataName) or
+		(oCheckpoint.mNumRows != GetNumRows()) or
+		(oCheckpoint.mNumCols != GetNumCols()) or
+		(oCheckpoint.mNumRandomizations != iNumRandomizations) or
+		(oCheckpoint.mShardIndex != mShardIndex) or
+		(oCheckpoint.mNumShards != mNumShards) or
+		(iHasPairStats and (oCheckpoint.mPairObserved.size() != mNumPairsSites)))
+	{
+		throw Error ("the checkpoint does not match this analysis");
+	}
+}
+
+
+// START CHECKPOINT
+// Prepare a checkpoint for a randomization run. If the app has asked for
+// a resume, read the saved one instead, check it again (see
+// ReadCheckpoint()) and pick up its run seed. Returns whether a run is
+// being resumed. The resume request is used up either way.
+bool MultiLocusModel::StartCheckpoint (Checkpoint& oCheckpoint,
+	const char* iAnalysis, UInt iNumRandomizations, bool iHasPairStats)
+{
+	bool theIsResuming = mResumeFromCheckpoint;
+	mResumeFromCheckpoint = false;
+	
+	if (theIsResuming)
+	{
+		ReadCheckpoint (oCheckpoint, iAnalysis, iNumRandomizations,
+			iHasPairStats);
+		mRunSeed = oCheckpoint.mRunSeed;
+		mRunSeedGiven = false;
+	}
+	else
+	{
+		ChooseRunSeed ();
+		oCheckpoint.Clear ();
+		oCheckpoint.mAnalysis = iAnalysis;
+		oCheckpoint.mDataName = mDataName;
+		oCheckpoint.mNumRows = GetNumRows();
+		oCheckpoint.mNumCols = GetNumCols();
+		oCheckpoint.mNumRandomizations = iNumRandomizations;
+		oCheckpoint.mShardIndex = mShardIndex;
+		oCheckpoint.mNumShards = mNumShards;
+		oCheckpoint.mRunSeed = mRunSeed;
 	}
+	
+	return theIsResuming;
+}
+
+
+// SAVE CHECKPOINT
+// The caller fills in the statistics & file offsets, this does the rest.
+void MultiLocusModel::SaveCheckpoint (Checkpoint& ioCheckpoint, UInt iRepNum)
+{
+	assert (mCheckpointStep != 0);
+	
+	ioCheckpoint.mRunSeed = mRunSeed;
+	ioCheckpoint.mLastReplicate = iRepNum;
+	ioCheckpoint.Write (mCheckpointPath.c_str());
+}
+
+
+// GET SHARD RANGE
+// A job split into shards gives each a contiguous slice of the replicates,
+// numbered as they would be in the whole run. Each replicate seeds the
+// generator with a hash of the run seed and its own number, so a shard
+// repeats exactly the replicates the whole run would have made, as long
+// as all shards share the run seed. The streams are not provably
+// disjoint: seeds are only 31 bits, so two replicates may (rarely) share
+// a seed or overlap, and independence is probabilistic, as it is for
+// an unsplit run. An unsplit run is just the one shard with all the
+// replicates.
+void MultiLocusModel::GetShardRange
+(UInt iNumRandomizations, UInt& oFirstRep, UInt& oLastRep)
+{
+	assert (0 < mNumShards);
+	assert (mShardIndex < mNumShards);
+	
+	unsigned long long theNumReps = iNumRandomizations;
+	oFirstRep = UInt ((theNumReps * mShardIndex) / mNumShards) + 1;
+	oLastRep = UInt ((theNumReps * (mShardIndex + 1)) / mNumShards);
+}
+
+
+// OUTPUT SHARD COUNTS
+// Instead of p-values (which would only be for this shard's slice of the
+// replicates) a shard ends its results with the raw counts of replicates
+// as extreme as the observed data, for the merge to add up.
+void MultiLocusModel::OutputShardCounts
+(ofstream& ioOutStream, UInt iNumRandomizations,
+	const vector<UInt>& iExceedances)
+{
+	UInt theFirstRep, theLastRep;
+	GetShardRange (iNumRandomizations, theFirstRep, theLastRep);
+	
+	ioOutStream << endl;
+	ioOutStream << "Shard\t" << mShardIndex + 1 << "\tof\t" << mNumShards
+		<< "\treplicates\t" << theFirstRep << "\tto\t" << theLastRep
+		<< "\tof\t" << iNumRandomizations << endl;
+	ioOutStream << "Seed\t" << mRunSeed << endl;
+	ioOutStream << "Exceedances";
+	for (UInt i = 0; i < iExceedances.size(); i++)
+		ioOutStream << "\t" << iExceedances[i];
+	ioOutStream << endl;
 }
 
 
@@ -819,126 +1318,488 @@ void MultiLocusModel::InitDTypeTranslations ()
 	// This provides translations of the diplotypes for PAUP output.
 	// Note under this scheme the ordering of alleles in pairs _is not_
 	// important, i.e. b/a is recognised as the same as a/b.
-	// TO DO: break this up so it only calculates dtypes once
-	bool	theDipTypeUnique;	
+	// CHANGE: each cell used to be compared to every diplotype seen before,
+	// in order, taking the first at distance 0. Complete diplotypes (no
+	// missing alleles) can only match themselves, so they are now found by
+	// hashing a/b & b/a alike. Only those with missing alleles, which may
+	// match several, are still compared one by one. The translation is
+	// exactly as before.
 	mDiploTrans.clear();	// array of unique dtypes
+	unordered_map<string, UInt>	theCompleteIds;	// by sorted alleles
+	vector<UInt>						theIncompleteIds;	// in order of discovery
 	
 	for (int i = 0; i < (int) GetNumCols(); i++ )	// foreach loci ...
 	{
 		for (int k = 0; k < (int) GetNumRows(); k++ )	// foreach isolate ...
 		{
-			theDipTypeUnique = true;
+			tAllelePair& theCell = mDiploData[k][i];
+			bool theIsComplete = not (IsMissing (theCell.alleleA) or
+				IsMissing (theCell.alleleB));
+			UInt theMatch = mDiploTrans.size();		// i.e. none
+			string theKey;
 			
-			// compare to the dtypes previous stored in gTransData
-			for (int m = 0; m < (int) mDiploTrans.size(); m++)
-			{	
-				// !! this looks like an error (comparing to an uninited
-				// array element), but isn't - you don't traverse the target 
-				// array until you have put elements in it.
-				ASSERT_VALIDINDEX(k,i);
-				
-				if (Distance ((*mDiploData)[k][i], mDiploTrans[m]) == 0)
+			if (theIsComplete)
+			{
+				// an earlier incomplete diplotype may match first
+				theKey = (theCell.alleleA < theCell.alleleB) ?
+					theCell.alleleA + '/' + theCell.alleleB :
+					theCell.alleleB + '/' + theCell.alleleA;
+				unordered_map<string, UInt>::iterator theFound =
+					theCompleteIds.find (theKey);
+				if (theFound != theCompleteIds.end())
+					theMatch = theFound->second;
+				for (UInt m = 0; m < theIncompleteIds.size(); m++)
+				{
+					if (theMatch < theIncompleteIds[m])
+						break;
+					if (Distance (theCell, mDiploTrans[theIncompleteIds[m]]) == 0)
+					{
+						theMatch = theIncompleteIds[m];
+						break;
+					}
+				}
+			}
+			else
+			{
+				for (UInt m = 0; m < mDiploTrans.size(); m++)
 				{
-					theDipTypeUnique = false;
-					// so all allelepairs of same dtype have same code
-					(*mDiploData)[k][i].transNumDTypes = mDiploTrans[m].transNumDTypes;
-					break;
+					if (Distance (theCell, mDiploTrans[m]) == 0)
+					{
+						theMatch = m;
+						break;
+					}
 				}
 			}
 			
 			// if it is not already there, put it there
-			if (theDipTypeUnique == true)
+			if (theMatch == mDiploTrans.size())
 			{
-				int theNumDipTypes = mDiploTrans.size ();
-				(*mDiploData)[k][i].transNumDTypes = GenerateDTypeSymbol (theNumDipTypes);
-				mDiploTrans.push_back ((*mDiploData)[k][i]);
+				if (theIsComplete)
+					theCompleteIds[theKey] = theMatch;
+				else
+					theIncompleteIds.push_back (theMatch);
+				mDiploTrans.push_back (theCell);
 			}
+			// so all allelepairs of same dtype have same code
+			theCell.transNumDTypes = theMatch;
 		}
 	}
 	
-	// prepares stepMat, a matrix of the distances between different diplotypes
-	int theNumDipTypes = mDiploTrans.size ();
-	vector<int>	theDipTypes (theNumDipTypes, 0);
-	mStepMatrix.clear ();
-	mStepMatrix.resize (theNumDipTypes, theDipTypes);
-	
-	for (int i = 0; i < theNumDipTypes; i++ )
+	// prepares stepMat, a matrix of the distances between different
+	// diplotypes, flattened & symmetric so only half need be calculated
+	UInt theNumDipTypes = mDiploTrans.size ();
+	mStepMatrix.assign (theNumDipTypes * theNumDipTypes, 0);
+	for (UInt i = 0; i < theNumDipTypes; i++ )
 	{
-		for (int j = 0; j < theNumDipTypes; j++ )
+		for (UInt j = i + 1; j < theNumDipTypes; j++ )
 		{
-			mStepMatrix[i][j] = Distance(mDiploTrans[i], mDiploTrans[j]);
+			uchar theDist = Distance (mDiploTrans[i], mDiploTrans[j]);
+			mStepMatrix[(i * theNumDipTypes) + j] = theDist;
+			mStepMatrix[(j * theNumDipTypes) + i] = theDist;
 		}
 	}
 }
 
 
 // GENERATE DIPLOTYPE SYMBOL
-// Given a number from 0 upwards, generates a char that is that dtype symbol
-char MultiLocusModel::GenerateDTypeSymbol (UInt iDipTypeIndex)
+// Given a number from 0 upwards, generates the symbol for that dtype. The
+// first are single characters, after which they are tokens, e.g. "D62".
+// CHANGE: there used to be a limit of 52 diplotypes.
+string MultiLocusModel::GenerateDTypeSymbol (UInt iDipTypeIndex)
 {
-	if (52 <= iDipTypeIndex)
-		throw FormatError("More than 52 diplotypes");
-
-	if (iDipTypeIndex < 26)
-	{
-		return ('A' + iDipTypeIndex);
-	}
-	else
-	{
-		assert (iDipTypeIndex < 52);
-		return ('a' + iDipTypeIndex);
-	}
+	if (iDipTypeIndex < kNumDTypeSymbols)
+		return string (1, kDTypeSymbols[iDipTypeIndex]);
+	
+	return "D" + toString (iDipTypeIndex);
 }
 
 
-// *** FILE & STREAM WRANGLING *******************************************/
-#pragma mark --
-
-
-void MultiLocusModel::InitFileWithSettings (ofstream& iFileStream)
+// ARE DIPLOTYPES TOKENS
+// Are there too many diplotypes for single-character symbols, so that the
+// PAUP matrix must be read as tokens?
+bool MultiLocusModel::AreDTypesTokens ()
 {
-	assert (iFileStream);
-	
-	PrintSettings (iFileStream);
-	iFileStream << endl;
-	PrintDataSet (iFileStream);
-	iFileStream << endl;
-	iFileStream << "---" << endl;
-	iFileStream << endl;
-	
-	iFileStream.setf(ios::showpoint);
+	return ((GetPloidy() == kPloidy_Diploid) and
+		(kNumDTypeSymbols < mDiploTrans.size()));
 }
 
 
-void MultiLocusModel::InitStatsFile (ofstream& iStatsStream)
+// INIT LOCUS DIPLOTYPES
+// Numbers the diplotypes seen at each locus & tabulates the distances
+// between them, so the fast engine looks distances up rather than compares
+// strings. Unlike the translations for PAUP, a/b & b/a are numbered apart,
+// so each entry is exactly the distance between the two cells. Shuffling
+// moves whole cells, so the numbers only need redoing when the shape of
+// the data changes.
+void MultiLocusModel::InitLocusDTypes ()
 {
-	assert (iStatsStream);
-
-	iStatsStream << "Diversity Stats from Data:" << endl;
-	iStatsStream << "--------------------------" << endl;
-	iStatsStream << endl;
-
+	UInt theNumLoci = GetNumCols ();
+	UInt theNumIso = GetNumRows ();
 	
-	InitFileWithSettings (iStatsStream);
+	mNumLocusDTypes.assign (theNumLoci, 0);
+	mLocusDTypeDists.assign (theNumLoci, vector<uchar>());
+	mLocusDTypeStrictDists.assign (theNumLoci, vector<uchar>());
 	
-	iStatsStream << "Replicate\tNumDiff\tMaxFreq\tDiver\tPrCompat\t"
-		<< "IndAssoc\trBarD\trBarS" << endl << endl;
-}
-
-
-void MultiLocusModel::InitThetaFile (ofstream& iThetaStream)
-{
-	assert (iThetaStream);
-
-	iThetaStream << "Calculation Theta bar, Observed Data:" << endl;
-	iThetaStream << "-------------------------------------" << endl;
-	iThetaStream << endl;
-
-	InitFileWithSettings (iThetaStream);
+	for (UInt i = 0; i < theNumLoci; i++)
+	{
+		map< pair<string,string>, UInt >	theIds;
+		vector<tAllelePair>					theDTypes;
+		
+		for (UInt k = 0; k < theNumIso; k++)
+		{
+			tAllelePair& theCell = mDiploData[k][i];
+			pair<string,string> theKey (theCell.alleleA, theCell.alleleB);
+			map< pair<string,string>, UInt >::iterator theMatch =
+				theIds.find (theKey);
+			if (theMatch == theIds.end())
+			{
+				theMatch = theIds.insert (make_pair (theKey,
+					(UInt) theDTypes.size())).first;
+				theDTypes.push_back (theCell);
+			}
+			theCell.dtypeId = theMatch->second;
+		}
+		
+		UInt theNumDTypes = theDTypes.size();
+		mNumLocusDTypes[i] = theNumDTypes;
+		mLocusDTypeDists[i].resize (theNumDTypes * theNumDTypes);
+		mLocusDTypeStrictDists[i].resize (theNumDTypes * theNumDTypes);
+		for (UInt m = 0; m < theNumDTypes; m++)
+		{
+			for (UInt n = 0; n < theNumDTypes; n++)
+			{
+				UInt theIndex = (m * theNumDTypes) + n;
+				mLocusDTypeDists[i][theIndex] =
+					Distance (theDTypes[m], theDTypes[n]);
+				mLocusDTypeStrictDists[i][theIndex] =
+					StrictDistance (theDTypes[m], theDTypes[n]);
+			}
+		}
+	}
 }
 
 
-void MultiLocusModel::InitPaupFile (ofstream& iPaupStream)
+// INIT LOCUS CODES
+// Codes the data locus by locus (see mLocusCodes). Like the diplotypes,
+// the codes move with the cells when shuffling, so they only need redoing
+// when the shape of the data changes.
+void MultiLocusModel::InitLocusCodes ()
+{
+	UInt theNumLoci = GetNumCols ();
+	UInt theNumIso = GetNumRows ();
+	
+	mLocusCodes.resize (theNumLoci * theNumIso);
+	mLocusClassAlleles.assign (theNumLoci, vector<UInt>());
+	mNumLocusAlleles.assign (theNumLoci, 0);
+	
+	for (UInt i = 0; i < theNumLoci; i++)
+	{
+		unordered_map<string,UInt>	theIds;
+		UInt*								theCodes = &mLocusCodes[i * theNumIso];
+		vector<UInt>&					theClassAlleles = mLocusClassAlleles[i];
+		
+		if (GetPloidy() == kPloidy_Haploid)
+		{
+			// each allele is a class, missing or not
+			theClassAlleles.assign (2, 0);
+			for (UInt k = 0; k < theNumIso; k++)
+			{
+				const tAllele& theCell = mHaploData[k][i];
+				UInt theId = 0;
+				if (not IsMissingAllele (theCell))
+				{
+					theId = theIds.insert (make_pair (theCell,
+						(UInt) theIds.size() + 1)).first->second;
+					if (theClassAlleles.size() <= 2 * theId)
+					{
+						theClassAlleles.push_back (theId);
+						theClassAlleles.push_back (theId);
+					}
+				}
+				theCodes[k] = theId;
+			}
+		}
+		else
+		{
+			theClassAlleles.assign (2 * mNumLocusDTypes[i], 0);
+			for (UInt k = 0; k < theNumIso; k++)
+			{
+				const tAllelePair& theCell = mDiploData[k][i];
+				const tAllele* theAlleles[] = {&theCell.alleleA, &theCell.alleleB};
+				for (UInt m = 0; m < 2; m++)
+				{
+					if (not IsMissingAllele (*theAlleles[m]))
+						theClassAlleles[(2 * theCell.dtypeId) + m] = theIds.insert
+							(make_pair (*theAlleles[m], (UInt) theIds.size() + 1)).first->second;
+				}
+				theCodes[k] = theCell.dtypeId;
+			}
+		}
+		mNumLocusAlleles[i] = theIds.size() + 1;
+	}
+}
+
+
+// INIT MISSING
+// Note the cells missing data, from the alleles of their classes, so that
+// IsMissing() & the like need not look at the alleles again.
+void MultiLocusModel::InitMissing ()
+{
+	UInt theNumLoci = GetNumCols ();
+	UInt theNumIso = GetNumRows ();
+	
+	mIsCellMissing.assign (theNumLoci * theNumIso, false);
+	mNumIsoMissing.assign (theNumIso, 0);
+	mNumLocusMissing.assign (theNumLoci, 0);
+	for (UInt i = 0; i < theNumLoci; i++)
+	{
+		const UInt*				theCodes = GetLocusCodes (i);
+		const vector<UInt>&	theClassAlleles = mLocusClassAlleles[i];
+		for (UInt k = 0; k < theNumIso; k++)
+		{
+			if ((theClassAlleles[2 * theCodes[k]] == 0) or
+				(theClassAlleles[(2 * theCodes[k]) + 1] == 0))
+			{
+				mIsCellMissing[(i * theNumIso) + k] = true;
+				mNumIsoMissing[k]++;
+				mNumLocusMissing[i]++;
+			}
+		}
+	}
+}
+
+
+// GET LOCUS CODES
+// The class of every isolate at a locus, in order, for kernels that would
+// rather read a locus straight through than step across the isolates.
+const UInt* MultiLocusModel::GetLocusCodes (UInt iLocus)
+{
+	assert (iLocus < GetNumCols());
+	return &mLocusCodes[iLocus * GetNumRows()];
+}
+
+
+UInt MultiLocusModel::GetNumLocusClasses (UInt iLocus)
+{
+	return (GetPloidy() == kPloidy_Haploid) ? mNumLocusAlleles[iLocus] :
+		mNumLocusDTypes[iLocus];
+}
+
+
+// NUMBER LOCUS CLASSES
+// The class of each of the given isolates at a locus & the distances
+// between the classes, as a flattened square. The classes are those of
+// the locus codes, whether or not the given isolates have them all.
+// Returns the number of classes.
+UInt MultiLocusModel::NumberLocusClasses (UInt iLocus,
+	const vector<UInt>& iRows, vector<UInt>& oClasses, vector<uchar>& oDists)
+{
+	const UInt*	theCodes = GetLocusCodes (iLocus);
+	UInt			theNumClasses = GetNumLocusClasses (iLocus);
+	
+	oClasses.resize (iRows.size());
+	for (UInt k = 0; k < iRows.size(); k++)
+		oClasses[k] = theCodes[iRows[k]];
+	
+	if (GetPloidy() == kPloidy_Diploid)
+	{
+		oDists = mLocusDTypeDists[iLocus];
+		return theNumClasses;
+	}
+	
+	// a missing allele is no distance from any
+	oDists.assign (theNumClasses * theNumClasses, 0);
+	for (UInt m = 1; m < theNumClasses; m++)
+	{
+		for (UInt n = 1; n < theNumClasses; n++)
+			oDists[(m * theNumClasses) + n] = (m == n) ? 0 : 1;
+	}
+	return theNumClasses;
+}
+
+
+// INIT BOOTSTRAP ENGINE
+// The class of each of the given isolates at every locus & the distances
+// between them (see NumberLocusClasses()).
+void MultiLocusModel::InitBootstrapEngine (BootstrapEngine& ioEngine,
+	const vector<UInt>& iRows)
+{
+	vector<UInt>	theClasses;
+	vector<uchar>	theDists;
+	for (UInt i = 0; i < GetNumCols (); i++)
+	{
+		UInt theNumClasses = NumberLocusClasses (i, iRows, theClasses, theDists);
+		ioEngine.SetLocus (i, theClasses, theNumClasses, theDists);
+	}
+}
+
+
+// *** PROGRESS **********************************************************/
+#pragma mark --
+
+// ADD / REMOVE OBSERVER
+// Observers aren't owned by the model. Adding one twice is harmless.
+void MultiLocusModel::AddObserver (ProgressObserver* iObserver)
+{
+	assert (iObserver != NULL);
+	if (find (mObservers.begin(), mObservers.end(), iObserver) == mObservers.end())
+		mObservers.push_back (iObserver);
+}
+
+
+void MultiLocusModel::RemoveObserver (ProgressObserver* iObserver)
+{
+	mObservers.erase (remove (mObservers.begin(), mObservers.end(), iObserver),
+		mObservers.end());
+}
+
+
+// START PROGRESS
+// Note the start of a run of replicates & tell the observers. Reports are
+// due on every multiple of the step, so the randomization loops need only
+// compare the replicate number against mNextProgressRep. Note that a
+// resumed run starts part way through the replicates.
+void MultiLocusModel::StartProgress (const char* iAnalysis, UInt iFirstRep,
+	UInt iLastRep, UInt iNumRandomizations, UInt iStep)
+{
+	assert (0 < iStep);
+	
+	mProgress.mAnalysis = iAnalysis;
+	mProgress.mFirstRep = iFirstRep;
+	mProgress.mLastRep = iLastRep;
+	mProgress.mNumRandomizations = iNumRandomizations;
+	mProgress.mReplicate = (0 < iFirstRep) ? iFirstRep - 1 : 0;
+	mProgress.mNumDone = 0;
+	mProgress.mElapsed = mProgress.mRate = 0.0;
+	mProgress.mRemaining = -1.0;
+	mProgressStep = iStep;
+	mNextProgressRep = ((iFirstRep + iStep - 1) / iStep) * iStep;
+	if (mNextProgressRep == 0)
+		mNextProgressRep = iStep;
+	mProgressStartTime = steady_clock::now();
+	
+	for (UInt i = 0; i < mObservers.size(); i++)
+		mObservers[i]->RunStarted (mProgress);
+}
+
+
+// REPORT PROGRESS
+// Called by the loops when replicate mNextProgressRep is done.
+void MultiLocusModel::ReportProgress (UInt iRepNum)
+{
+	UpdateProgress (iRepNum);
+	mNextProgressRep += mProgressStep;
+	for (UInt i = 0; i < mObservers.size(); i++)
+		mObservers[i]->ReplicatesDone (mProgress);
+}
+
+
+void MultiLocusModel::FinishProgress ()
+{
+	UpdateProgress (mProgress.mLastRep);
+	mProgress.mRemaining = 0.0;
+	mNextProgressRep = kNoProgressDue;
+	for (UInt i = 0; i < mObservers.size(); i++)
+		mObservers[i]->RunFinished (mProgress);
+}
+
+
+// START & FINISH PHASES
+// Each analysis is profiled from scratch, apart from the parsing of the
+// data. At the end the observers are shown where the time went.
+void MultiLocusModel::StartPhases ()
+{
+	mProfile.ClearAnalysis ();
+}
+
+
+void MultiLocusModel::FinishPhases (const char* iAnalysis)
+{
+	mProfile.Flush ();
+	for (UInt i = 0; i < mObservers.size(); i++)
+		mObservers[i]->PhasesTimed (iAnalysis, mProfile);
+}
+
+
+const PhaseProfile& MultiLocusModel::GetProfile ()
+{
+	mProfile.Flush ();
+	return mProfile;
+}
+
+
+// UPDATE PROGRESS
+// Work out the timing for the last replicate done. The time left assumes
+// the rate so far holds for the rest of the run.
+void MultiLocusModel::UpdateProgress (UInt iRepNum)
+{
+	duration<double> theElapsed = steady_clock::now() - mProgressStartTime;
+	
+	mProgress.mReplicate = iRepNum;
+	mProgress.mNumDone = (mProgress.mFirstRep <= iRepNum) ?
+		iRepNum - mProgress.mFirstRep + 1 : 0;
+	mProgress.mElapsed = theElapsed.count();
+	if ((0 < mProgress.mNumDone) and (0.0 < mProgress.mElapsed))
+	{
+		mProgress.mRate = mProgress.mNumDone / mProgress.mElapsed;
+		mProgress.mRemaining = (mProgress.mLastRep - iRepNum) / mProgress.mRate;
+	}
+	else
+	{
+		mProgress.mRate = 0.0;
+		mProgress.mRemaining = -1.0;
+	}
+}
+
+
+// *** FILE & STREAM WRANGLING *******************************************/
+#pragma mark --
+
+
+void MultiLocusModel::InitFileWithSettings (ofstream& iFileStream)
+{
+	assert (iFileStream);
+	
+	PrintSettings (iFileStream);
+	iFileStream << endl;
+	PrintDataSet (iFileStream);
+	iFileStream << endl;
+	iFileStream << "---" << endl;
+	iFileStream << endl;
+	
+	iFileStream.setf(ios::showpoint);
+}
+
+
+void MultiLocusModel::InitStatsFile (ofstream& iStatsStream)
+{
+	assert (iStatsStream);
+
+	iStatsStream << "Diversity Stats from Data:" << endl;
+	iStatsStream << "--------------------------" << endl;
+	iStatsStream << endl;
+
+	
+	InitFileWithSettings (iStatsStream);
+	
+	iStatsStream << "Replicate\tNumDiff\tMaxFreq\tDiver\tPrCompat\t"
+		<< "IndAssoc\trBarD\trBarS" << endl << endl;
+}
+
+
+void MultiLocusModel::InitThetaFile (ofstream& iThetaStream)
+{
+	assert (iThetaStream);
+
+	iThetaStream << "Calculation Theta bar, Observed Data:" << endl;
+	iThetaStream << "-------------------------------------" << endl;
+	iThetaStream << endl;
+
+	InitFileWithSettings (iThetaStream);
+}
+
+
+void MultiLocusModel::InitPaupFile (ofstream& iPaupStream)
 {
 	assert (iPaupStream);
 
@@ -978,7 +1839,7 @@ void MultiLocusModel::InitPaupFile (ofstream& iPaupStream)
 		{
 			iPaupStream << "\t[ " << mDiploTrans[i].alleleA
 				<< "/" << mDiploTrans[i].alleleB << " --> "
-				<< mDiploTrans[i].transNumDTypes << " ]" << endl;
+				<< GenerateDTypeSymbol (i) << " ]" << endl;
 		}
 		
 		iPaupStream << endl;
@@ -1033,6 +1894,52 @@ void MultiLocusModel::InitPlotFile (ofstream& ioPlotStream)
 }
 
 
+void MultiLocusModel::InitWindowsFile (ofstream& ioWindowStream, UInt iWidth,
+	UInt iStep)
+{
+	assert (ioWindowStream);
+
+	ioWindowStream << "Linkage Disequilibrium in Windows of Loci" << endl;
+	ioWindowStream << "-----------------------------------------" << endl;
+	ioWindowStream << endl;
+
+	InitFileWithSettings (ioWindowStream);
+
+	ioWindowStream << "Windows of " << iWidth << " loci, every " << iStep
+		<< " loci" << endl << endl;
+	ioWindowStream << "Window\tFirst_Locus\tLast_Locus\tIndAssoc\tP_Value\t"
+		<< "rBarD\tP_Value" << endl << endl;
+}
+
+
+void MultiLocusModel::InitJackknifeFile (ofstream& ioJackStream)
+{
+	assert (ioJackStream);
+
+	ioJackStream << "Linkage Disequilibrium with Each Locus Removed" << endl;
+	ioJackStream << "----------------------------------------------" << endl;
+	ioJackStream << endl;
+
+	InitFileWithSettings (ioJackStream);
+
+	ioJackStream << "Locus_Removed\tIndAssoc\trBarD" << endl << endl;
+}
+
+
+void MultiLocusModel::InitBootstrapFile (ofstream& ioBootStream)
+{
+	assert (ioBootStream);
+
+	ioBootStream << "Bootstrap Resampling of Isolates" << endl;
+	ioBootStream << "--------------------------------" << endl;
+	ioBootStream << endl;
+
+	InitFileWithSettings (ioBootStream);
+
+	ioBootStream << "Replicate\tNumDiff\tDiver\tIndAssoc\trBarD" << endl << endl;
+}
+
+
 // *** OUTPUT ************************************************************/
 #pragma mark --
 
@@ -1090,6 +1997,13 @@ void MultiLocusModel::PrintSettings (ostream& oSettingsStream)
 	if (not (mExcludeIso or mExcludeLoci))
 		oSettingsStream << "All datapoints included";
 	oSettingsStream << "." << endl;
+	
+	if (0.0 < mPairSampleError)
+	{
+		oSettingsStream << "Variance of distances over all loci estimated from "
+			<< "sampled pairs of isolates, to a standard error of " << toString (100.0 *
+			mPairSampleError) << "%." << endl;
+	}
 }
 
 
@@ -1151,6 +2065,9 @@ void MultiLocusModel::PrintDataSet (ostream& ioOutStream)
 // included.
 void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 {	
+	StartPhases ();
+	ScopedPhase thePhase (mProfile, kPhase_PlotDiv);
+	
 	// 1. init output file
 	assert (ioPlotStream);
 	InitPlotFile(ioPlotStream);
@@ -1192,35 +2109,54 @@ void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 			
 			// 4a. do calculations for Gtypes & diversity
 			int			thePairNum = 0;
-			vector<int> theIsoDistArray(mNumPairsIsolates,0);
 			
-			// for every pair of isolates ...
-			for (int m = 0; m < theNumIso - 1; m++ )
+			// CHANGE: the fast engine asks the ploidy once, not for every cell,
+			// & streams the distances through reducers rather than holding them.
+			if (mEngine == kEngine_Fast)
+			{
+				vector<UInt> theLoci;
+				for (int o = 0; o < (int) theLociSample.Size(); o++ )
+					theLoci.push_back (theLociSample.at(o));
+				ZeroPairClusters theClusters (theNumIso);
+				PairMoments theMoments;
+				BothReducers<ZeroPairClusters,PairMoments> theReducers (theClusters,
+					theMoments);
+				StreamPairDists (theLoci, theReducers);
+				theNumGtypesArr[j] = theClusters.CountGtypes();
+				theDivArr[j] = theMoments.mNumDiffPairs / theMoments.mNumPairs;
+			}
+			else
 			{
-				for (int n = m + 1; n < theNumIso; n++ )
+				vector<int> theIsoDistArray(mNumPairsIsolates,0);
+				
+				// for every pair of isolates ...
+				for (int m = 0; m < theNumIso - 1; m++ )
 				{
-					assert (thePairNum < (int) mNumPairsIsolates);
-					
-					// for every site selected, sum the distances involved
-					for (int o = 0; o < (int) theLociSample.Size(); o++ )
+					for (int n = m + 1; n < theNumIso; n++ )
 					{
-						int theLociIndex = theLociSample.at(o);
+						assert (thePairNum < (int) mNumPairsIsolates);
+					
+						// for every site selected, sum the distances involved
+						for (int o = 0; o < (int) theLociSample.Size(); o++ )
+						{
+							int theLociIndex = theLociSample.at(o);
 						
-						int theDist = (GetPloidy() == kPloidy_Haploid) ?
-							Distance ((*mHaploData)[m][theLociIndex], (*mHaploData)[n][theLociIndex]) :
-							Distance ((*mDiploData)[m][theLociIndex], (*mDiploData)[n][theLociIndex]);
+							int theDist = (GetPloidy() == kPloidy_Haploid) ?
+								Distance (mHaploData[m][theLociIndex], mHaploData[n][theLociIndex]) :
+								Distance (mDiploData[m][theLociIndex], mDiploData[n][theLociIndex]);
 						
-						theIsoDistArray.at(thePairNum) += theDist;					
+							theIsoDistArray.at(thePairNum) += theDist;					
+						}
+						thePairNum++;
 					}
-					thePairNum++;
 				}
-			}
 			
-			// now have a vector of isolate distances, theIsoDistArray
-			// theTotalNumGTypes +=	CountGtypesFromDist (theIsoDistArray);
-			// theTotalDiversity += CalcDivFromDist (theIsoDistArray);
-			theNumGtypesArr[j] = CountGtypesFromDist (theIsoDistArray);
-			theDivArr[j] = CalcDivFromDist (theIsoDistArray);
+				// now have a vector of isolate distances, theIsoDistArray
+				// theTotalNumGTypes +=	CountGtypesFromDist (theIsoDistArray);
+				// theTotalDiversity += CalcDivFromDist (theIsoDistArray);
+				theNumGtypesArr[j] = CountGtypesFromDist (theIsoDistArray);
+				theDivArr[j] = CalcDivFromDist (theIsoDistArray);
+			}
 			
 // !!! FOR TESTING, NOT FOR GENERAL RELEASE !!!
 #ifdef PAPER_HACK
@@ -1249,8 +2185,8 @@ void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 						ASSERT_VALIDINDEX(b,theSiteIndex);
 						
 						int theDist = (GetPloidy() == kPloidy_Haploid) ?
-							Distance ((*mHaploData)[a][theSiteIndex], (*mHaploData)[b][theSiteIndex]) :
-							Distance ((*mDiploData)[a][theSiteIndex], (*mDiploData)[b][theSiteIndex]);					
+							Distance (mHaploData[a][theSiteIndex], mHaploData[b][theSiteIndex]) :
+							Distance (mDiploData[a][theSiteIndex], mDiploData[b][theSiteIndex]);					
 						assert (0 <= theDist);
 						theHackDistArr.at(thePairNum) += theDist;
 					}
@@ -1300,8 +2236,8 @@ void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 							
 							// sum the distances and squares of distances
 							int theDistance = (GetPloidy() == kPloidy_Haploid)
-								? Distance ((*mHaploData)[b][theSiteIndex], (*mHaploData)[c][theSiteIndex])
-								: Distance ((*mDiploData)[b][theSiteIndex], (*mDiploData)[c][theSiteIndex]);
+								? Distance (mHaploData[b][theSiteIndex], mHaploData[c][theSiteIndex])
+								: Distance (mDiploData[b][theSiteIndex], mDiploData[c][theSiteIndex]);
 						
 							assert (0 <= theDistance);
 							theSumDist += theDistance;
@@ -1313,7 +2249,7 @@ void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 					assert (0 <= theSumSquares);
 					
 					theVarDist.at(a) = ((double) theSumSquares - ((double)
-						(theSumDist * theSumDist) / (double) mNumPairsIsolates)) /
+						theSumDist * (double) theSumDist / (double) mNumPairsIsolates)) /
 						(double) mNumPairsIsolates;
 					// theSumVarDist += theVarDist.at(i);
 				}
@@ -1413,6 +2349,8 @@ void MultiLocusModel::PlotDiv (int iNumSamples, ofstream& ioPlotStream)
 			
 		ioPlotStream << endl;
 	}
+	
+	FinishPhases (kAnalysis_PlotDiv);
 }
 
 	
@@ -1420,6 +2358,8 @@ void MultiLocusModel::CalcDiversity
 (bool iDoPairwiseStats, int iNumRandomizations, bool iDoPaupOutput,
 	ofstream& iStatsStream, ofstream& iPairsStream, ofstream& iPaupStream)
 {
+	StartPhases ();
+	
 	// 1. do necessary preparatory calculations
 	CalcVarDistances();
 	// Change: (00.1.25) not needed anymore
@@ -1436,36 +2376,82 @@ void MultiLocusModel::CalcDiversity
 	double	theDiversityOrig, thePorpCompatOrig, theIndexAssocOrig,
 				theRBarDOrig, theRBarSOrig;
 	
-	InitStatsFile (iStatsStream);
-	if (iDoPaupOutput)
-		InitPaupFile (iPaupStream);
 	if (iDoPairwiseStats)
 	{
-		InitPairsFile (iPairsStream);
 		thePairPVals.resize (mNumPairsSites, 0.0);
 		thePairwiseR.resize (mNumPairsSites, 0);		
 	}
 	
+	// CHANGE: if resuming from a checkpoint, the output files have already
+	// been started (and cut back to where the checkpoint was taken) and
+	// the observed values & counts so far come from the checkpoint.
+	// CHANGE: a shard does the observed data and then only its own slice
+	// of the replicates.
+	UInt			theShardFirst, theShardLast;
+	GetShardRange (iNumRandomizations, theShardFirst, theShardLast);
+	int			theLastRep = int (theShardLast);
+	Checkpoint	theCheckpoint;
+	int			theFirstRep = 0;
+	bool			theIsResumed = StartCheckpoint (theCheckpoint,
+		kAnalysis_Diversity, iNumRandomizations, iDoPairwiseStats);
+	if (theIsResumed)
+	{
+		theFirstRep = theCheckpoint.mLastReplicate + 1;
+		theNumDiffOrig = int (theCheckpoint.mObserved[kPval_NumDiff]);
+		theMaxFreqOrig = int (theCheckpoint.mObserved[kPval_MaxFreq]);
+		theDiversityOrig = theCheckpoint.mObserved[kPval_Diversity];
+		thePorpCompatOrig = theCheckpoint.mObserved[kPval_PorpCompat];
+		theIndexAssocOrig = theCheckpoint.mObserved[kPval_IndexAssoc];
+		theRBarDOrig = theCheckpoint.mObserved[kPval_RBarD];
+		theRBarSOrig = theCheckpoint.mObserved[kPval_RBarS];
+		thePVals = theCheckpoint.mExceedances;
+		if (iDoPairwiseStats)
+		{
+			thePairwiseR = theCheckpoint.mPairObserved;
+			thePairPVals = theCheckpoint.mPairExceedances;
+			iPairsStream.setf (ios::showpoint);
+		}
+		iStatsStream.setf (ios::showpoint);
+		if (iDoPaupOutput)
+		{
+			iPaupStream.setf (ios::showpoint);
+			if (GetPloidy() == kPloidy_Diploid)
+				InitDTypeTranslations ();
+		}
+		BackupWorkingData ();
+	}
+	else
+	{
+		InitStatsFile (iStatsStream);
+		if (iDoPaupOutput)
+			InitPaupFile (iPaupStream);
+		if (iDoPairwiseStats)
+			InitPairsFile (iPairsStream);
+	}
+	
 	// 3. and do stats for every randomization	
-	for (int i = 0; i < iNumRandomizations + 1; i++)
+	// CHANGE: progress now goes to any observers, not cout
+	if (iNumRandomizations)
+		StartProgress (kAnalysis_Diversity,
+			(theFirstRep == 0) ? theShardFirst : UInt (theFirstRep), theShardLast,
+			iNumRandomizations, kRandomProgressStep);
+	for (int i = theFirstRep; i <= theLastRep;
+		i = (i == 0) ? int (theShardFirst) : i + 1)
 	{
-		// Signal progress of randomizations.
-		// To Do: This is a bloody awful nasty hack that breaks the
-		// model-app barrier and will give us grief elsewhere. Find a
-		// better way to do this.
-		if (((i % kRandomProgressStep) == 0) and (i != 0))
-			cout << "Doing randomization " << i << " of "
-				<< iNumRandomizations << " ..." << endl;
-		
 		// !! create / load data if necessary
 		// !! if randomising data, the first time through loop just save the
 		// numbers. Subsequent times, restore and shuffle.
 		if (iNumRandomizations)	
 		{
 			if (i == 0)
+			{
 				BackupWorkingData ();
+			}
 			else
+			{
+				SeedReplicate (i);
 				ShuffleDataset ();
+			}
 		}
 		
 		// calculate general diversity
@@ -1531,23 +2517,34 @@ void MultiLocusModel::CalcDiversity
 		// print out stats to stats stream
 		// XXX: wtf?
 		// assert (iStatsStream != NULL);
-
-		if (i == 0)
-		{
-			iStatsStream << "Observed";
-		}
-		else
 		{
-			iStatsStream << i;
+			ScopedPhase theOutputPhase (mProfile, kPhase_Output);
+			
+			if (i == 0)
+			{
+				iStatsStream << "Observed";
+			}
+			else
+			{
+				iStatsStream << i;
+			}
+					
+			iStatsStream << "\t" << theNumDiff << "\t" << theMaxFreq << "\t"
+				<< theDiversity << "\t" << thePorpCompat << "\t" << theIndexAssoc
+				<< "\t" << theRBarD << "\t";
+			if (not mIsDataRankable)
+				iStatsStream << "N/A" << endl;
+			else
+				iStatsStream << theRBarS << endl;
+			
+			// CHANGE: estimates from sampled pairs are given with their
+			// standard errors
+			if ((i == 0) and (0.0 < mPairSampleError))
+			{
+				iStatsStream << "Std_Error\tN/A\tN/A\tN/A\tN/A\t"
+					<< mIndexAssocError << "\t" << mRBarDError << "\tN/A" << endl;
+			}
 		}
-				
-		iStatsStream << "\t" << theNumDiff << "\t" << theMaxFreq << "\t"
-			<< theDiversity << "\t" << thePorpCompat << "\t" << theIndexAssoc
-			<< "\t" << theRBarD << "\t";
-		if (not mIsDataRankable)
-			iStatsStream << "N/A" << endl;
-		else
-			iStatsStream << theRBarS << endl;
 		
 		if (iDoPairwiseStats)
 		{
@@ -1578,9 +2575,12 @@ void MultiLocusModel::CalcDiversity
 		{
 			iPaupStream << "BEGIN DATA;" << endl;
 			iPaupStream << "\tDIMENSIONS ntax=" << (int) GetNumRows()
-				<< " nchar=" << (int) GetNumCols() << "; format respectcase missing=? "
-				<< "symbols=\"0123456789abcdefghijklmnopqrstuvwxyz"
-				<< "ABCDEFGHIJKLMNOPQRSTUVWXYZ\";" << endl;
+				<< " nchar=" << (int) GetNumCols() << "; format respectcase missing=? ";
+			if (AreDTypesTokens ())
+				iPaupStream << "tokens;" << endl;
+			else
+				iPaupStream << "symbols=\"0123456789abcdefghijklmnopqrstuvwxyz"
+					<< "ABCDEFGHIJKLMNOPQRSTUVWXYZ\";" << endl;
 			iPaupStream << "\tMATRIX" << endl;
 			iPaupStream << "\t[!";
 			if (i == 0)
@@ -1595,11 +2595,48 @@ void MultiLocusModel::CalcDiversity
 		// restore data to pristine condition if need be
 		if (iNumRandomizations and (i != 0))	
 			RestoreWorkingData ();
+		
+		// save progress every so often, but not at the very end
+		if (mCheckpointStep and (i != 0) and ((i % mCheckpointStep) == 0)
+			and (i < theLastRep))
+		{
+			double theObserved[kPval_Size] = { double (theNumDiffOrig),
+				double (theMaxFreqOrig), theDiversityOrig, thePorpCompatOrig,
+				theIndexAssocOrig, theRBarDOrig, theRBarSOrig };
+			theCheckpoint.mObserved.assign (theObserved, theObserved + kPval_Size);
+			theCheckpoint.mExceedances = thePVals;
+			theCheckpoint.mPairObserved = thePairwiseR;
+			theCheckpoint.mPairExceedances = thePairPVals;
+			iStatsStream.flush ();
+			theCheckpoint.mOffsets[kOutput_Stats] = long (iStatsStream.tellp());
+			if (iDoPairwiseStats)
+			{
+				iPairsStream.flush ();
+				theCheckpoint.mOffsets[kOutput_Pairs] = long (iPairsStream.tellp());
+			}
+			if (iDoPaupOutput)
+			{
+				iPaupStream.flush ();
+				theCheckpoint.mOffsets[kOutput_Paup] = long (iPaupStream.tellp());
+			}
+			SaveCheckpoint (theCheckpoint, i);
+		}
+		
+		if (i == int (mNextProgressRep))
+			ReportProgress (i);
 	}
+	if (iNumRandomizations)
+		FinishProgress ();
 	
 	// 4. if there have been randomizations, output p values & tidy up
 	
-	if (iNumRandomizations)
+	if (iNumRandomizations and IsSharded())
+	{
+		// a shard can't give p-values, only its part of the counts
+		OutputShardCounts (iStatsStream, iNumRandomizations, thePVals);
+		RestoreWorkingData ();
+	}
+	else if (iNumRandomizations)
 	{
 		assert (iStatsStream);
 		iStatsStream << endl << "P_Values";
@@ -1693,6 +2730,548 @@ void MultiLocusModel::CalcDiversity
 		iPairsStream << endl;
 	}
 
+	// the run is complete, so any checkpoint it saved or resumed from is stale
+	if (mCheckpointStep or theIsResumed)
+		Checkpoint::Remove (mCheckpointPath.c_str());
+	
+	FinishPhases (kAnalysis_Diversity);
+}
+
+
+// CALCULATE WINDOWS
+// The index of association & rBarD in windows of loci along the dataset,
+// each with p-values from randomizations of the whole dataset. Loci are
+// taken to be in the order they are found along the genome. Windows
+// without any variation get "N/A".
+// CHANGE: windows don't checkpoint or shard like CalcDiversity(), as a
+// run is no longer than a few of those.
+void MultiLocusModel::CalcWindows
+(UInt iWidth, UInt iStep, int iNumRandomizations, ofstream& ioWindowStream)
+{
+	StartPhases ();
+	
+	// 1. the expected variances of each locus don't change under shuffling
+	CalcVarDistances ();
+	InitWindowsFile (ioWindowStream, iWidth, iStep);
+	
+	// 2. the observed windows
+	vector<double>	theIndexAssocOrig, theRBarDOrig;
+	CalcWindowStats (iWidth, iStep, theIndexAssocOrig, theRBarDOrig);
+	UInt theNumWindows = theIndexAssocOrig.size();
+	vector<UInt>	theIndexAssocPVals (theNumWindows, 0);
+	vector<UInt>	theRBarDPVals (theNumWindows, 0);
+	
+	// 3. and every window of every randomization
+	if (iNumRandomizations)
+	{
+		BackupWorkingData ();
+		StartProgress (kAnalysis_Windows, 1, iNumRandomizations,
+			iNumRandomizations, kRandomProgressStep);
+	}
+	for (int i = 1; i <= iNumRandomizations; i++)
+	{
+		SeedReplicate (i);
+		ShuffleDataset ();
+		
+		vector<double>	theIndexAssoc, theRBarD;
+		CalcWindowStats (iWidth, iStep, theIndexAssoc, theRBarD);
+		for (UInt j = 0; j < theNumWindows; j++)
+		{
+			if (theIndexAssoc[j] >= theIndexAssocOrig[j])
+				theIndexAssocPVals[j]++;
+			if (theRBarD[j] >= theRBarDOrig[j])
+				theRBarDPVals[j]++;
+		}
+		
+		RestoreWorkingData ();
+		if (i == int (mNextProgressRep))
+			ReportProgress (i);
+	}
+	if (iNumRandomizations)
+		FinishProgress ();
+	
+	// 4. output the windows
+	{
+		ScopedPhase theOutputPhase (mProfile, kPhase_Output);
+		
+		for (UInt j = 0; j < theNumWindows; j++)
+		{
+			ioWindowStream << j + 1 << "\t" << (j * iStep) + 1 << "\t"
+				<< (j * iStep) + iWidth;
+			
+			bool theIsVaried = not std::isnan (theIndexAssocOrig[j]);
+			double theStat[2] = { theIndexAssocOrig[j], theRBarDOrig[j] };
+			UInt thePVal[2] = { theIndexAssocPVals[j], theRBarDPVals[j] };
+			for (int k = 0; k < 2; k++)
+			{
+				ioWindowStream << "\t";
+				if (theIsVaried)
+					ioWindowStream << theStat[k];
+				else
+					ioWindowStream << "N/A";
+				
+				ioWindowStream << "\t";
+				if ((not theIsVaried) or (iNumRandomizations == 0))
+					ioWindowStream << "N/A";
+				else if (thePVal[k] == 0)
+					ioWindowStream << "< " << (1.0 / double (iNumRandomizations));
+				else
+					ioWindowStream << (double (thePVal[k]) /
+						double (iNumRandomizations));
+			}
+			ioWindowStream << endl;
+		}
+	}
+	
+	FinishPhases (kAnalysis_Windows);
+}
+
+
+// CALCULATE WINDOW STATISTICS
+// The index of association & rBarD for each window of the current data,
+// the windows starting at the first locus & every iStep loci after while
+// there are iWidth loci left. CalcVarDistances() must have been called.
+// The reference engine works out every window from scratch. The fast
+// engine keeps the summed distances between isolates over the window &
+// takes away the distances at the loci leaving it & adds those at the
+// loci entering it, unless it's quicker to start again.
+void MultiLocusModel::CalcWindowStats (UInt iWidth, UInt iStep,
+	vector<double>& oIndexAssoc, vector<double>& oRBarD)
+{
+	ScopedPhase thePhase (mProfile, kPhase_Windows);
+	UInt theNumSites = GetNumCols ();
+	assert ((0 < iWidth) and (iWidth <= theNumSites) and (0 < iStep));
+	
+	UInt theNumWindows = ((theNumSites - iWidth) / iStep) + 1;
+	oIndexAssoc.resize (theNumWindows);
+	oRBarD.resize (theNumWindows);
+	
+	// CHANGE: the fast engine holds the distances as narrow as a window
+	// allows.
+	vector<int>		theDistArray;
+	PairDistArray	theDists;
+	for (UInt i = 0; i < theNumWindows; i++)
+	{
+		UInt theFirst = i * iStep;
+		UInt theLast = theFirst + iWidth;	// one past the window
+		double theSumVarDist = 0.0, theMaxSumCov = 0.0;
+		
+		if (mEngine == kEngine_Fast)
+		{
+			if ((i == 0) or (iWidth <= (2 * iStep)))
+			{
+				theDists.Reset (mNumPairsIsolates, GetMaxLocusDist() * iWidth);
+				for (UInt j = theFirst; j < theLast; j++)
+					AddLocusToDistArray (j, 1, theDists);
+			}
+			else
+			{
+				for (UInt j = theFirst - iStep; j < theFirst; j++)
+					AddLocusToDistArray (j, -1, theDists);
+				for (UInt j = theLast - iStep; j < theLast; j++)
+					AddLocusToDistArray (j, 1, theDists);
+			}
+			
+			theMaxSumCov = SumMaxCovariance (mVarDist, theFirst, theLast, theLast);
+			for (UInt j = theFirst; j < theLast; j++)
+				theSumVarDist += mVarDist[j];
+			IndexAssocFromDist (theDists, theSumVarDist, theMaxSumCov,
+				oIndexAssoc[i], oRBarD[i]);
+		}
+		else
+		{
+			theDistArray.assign (mNumPairsIsolates, 0);
+			long thePairNum = 0;
+			for (int k = 0; k < int (GetNumRows()) - 1; k++)
+			{
+				for (int m = k + 1; m < int (GetNumRows()); m++)
+				{
+					for (UInt j = theFirst; j < theLast; j++)
+					{
+						theDistArray[thePairNum] += (GetPloidy() == kPloidy_Haploid) ?
+							Distance (mHaploData[k][j], mHaploData[m][j]) :
+							Distance (mDiploData[k][j], mDiploData[m][j]);
+					}
+					thePairNum++;
+				}
+			}
+			
+			for (UInt j = theFirst; j < theLast; j++)
+			{
+				theSumVarDist += mVarDist[j];
+				for (UInt n = j + 1; n < theLast; n++)
+					theMaxSumCov += sqrt ((double) mVarDist[j] * (double) mVarDist[n]);
+			}
+			IndexAssocFromDist (theDistArray, theSumVarDist, theMaxSumCov,
+				oIndexAssoc[i], oRBarD[i]);
+		}
+	}
+}
+
+
+// CALCULATE JACKKNIFE
+// The index of association & rBarD of the data with each locus removed in
+// turn, to show which loci the linkage disequilibrium comes from, and the
+// jackknife standard errors of both.
+void MultiLocusModel::CalcJackknife (ofstream& ioJackStream)
+{
+	StartPhases ();
+	
+	// 1. the whole dataset
+	CalcVarDistances ();
+	InitJackknifeFile (ioJackStream);
+	double theIndexAssoc, theRBarD;
+	CalcIndexAssocRBarD (theIndexAssoc, theRBarD);
+	
+	// 2. without each locus
+	vector<double>	theLociIndexAssoc, theLociRBarD;
+	CalcJackknifeStats (theLociIndexAssoc, theLociRBarD);
+	
+	// 3. output
+	{
+		ScopedPhase theOutputPhase (mProfile, kPhase_Output);
+		UInt theNumSites = theLociIndexAssoc.size();
+		vector< valarray<double> > theStats (2, valarray<double> (theNumSites));
+		for (UInt i = 0; i < theNumSites; i++)
+		{
+			theStats[0][i] = theLociIndexAssoc[i];
+			theStats[1][i] = theLociRBarD[i];
+		}
+		
+		ioJackStream << "None\t" << theIndexAssoc << "\t" << theRBarD << endl;
+		for (UInt i = 0; i < theNumSites; i++)
+		{
+			ioJackStream << i + 1;
+			for (int k = 0; k < 2; k++)
+			{
+				ioJackStream << "\t";
+				if (std::isnan (theStats[k][i]))
+					ioJackStream << "N/A";
+				else
+					ioJackStream << theStats[k][i];
+			}
+			ioJackStream << endl;
+		}
+		
+		// the jackknife standard error is sqrt ((n - 1) / n * sum (x - mean)^2)
+		ioJackStream << endl << "Std_Error";
+		for (int k = 0; k < 2; k++)
+		{
+			double theMean = theStats[k].sum() / double (theNumSites);
+			valarray<double> theDevs = theStats[k] - theMean;
+			double theError = sqrt ((double (theNumSites - 1) /
+				double (theNumSites)) * (theDevs * theDevs).sum());
+			ioJackStream << "\t";
+			if (std::isnan (theError))
+				ioJackStream << "N/A";
+			else
+				ioJackStream << theError;
+		}
+		ioJackStream << endl;
+	}
+	
+	FinishPhases (kAnalysis_Jackknife);
+}
+
+
+// CALCULATE JACKKNIFE STATISTICS
+// The index of association & rBarD with each locus removed in turn.
+// CalcVarDistances() must have been called. The reference engine works
+// out the distances over the other loci from scratch each time. The fast
+// engine works out the distances over all loci once & takes away those at
+// each locus, then adds them back again.
+void MultiLocusModel::CalcJackknifeStats (vector<double>& oIndexAssoc,
+	vector<double>& oRBarD)
+{
+	ScopedPhase thePhase (mProfile, kPhase_Jackknife);
+	UInt theNumSites = GetNumCols ();
+	
+	oIndexAssoc.resize (theNumSites);
+	oRBarD.resize (theNumSites);
+	
+	// CHANGE: the fast engine holds the distances as narrow as all loci
+	// allow.
+	vector<int>		theDistArray;
+	PairDistArray	theDists;
+	if (mEngine == kEngine_Fast)
+		CalcPairDists (theDists);
+	for (UInt i = 0; i < theNumSites; i++)
+	{
+		double theSumVarDist = 0.0, theMaxSumCov = 0.0;
+		for (UInt j = 0; j < theNumSites; j++)
+		{
+			if (j != i)
+				theSumVarDist += mVarDist[j];
+		}
+		
+		if (mEngine == kEngine_Fast)
+		{
+			theMaxSumCov = SumMaxCovariance (mVarDist, 0, theNumSites, i);
+			AddLocusToDistArray (i, -1, theDists);
+			IndexAssocFromDist (theDists, theSumVarDist, theMaxSumCov,
+				oIndexAssoc[i], oRBarD[i]);
+			AddLocusToDistArray (i, 1, theDists);
+		}
+		else
+		{
+			theDistArray.assign (mNumPairsIsolates, 0);
+			long thePairNum = 0;
+			for (int k = 0; k < int (GetNumRows()) - 1; k++)
+			{
+				for (int m = k + 1; m < int (GetNumRows()); m++)
+				{
+					for (UInt j = 0; j < theNumSites; j++)
+					{
+						if (j == i)
+							continue;
+						theDistArray[thePairNum] += (GetPloidy() == kPloidy_Haploid) ?
+							Distance (mHaploData[k][j], mHaploData[m][j]) :
+							Distance (mDiploData[k][j], mDiploData[m][j]);
+					}
+					thePairNum++;
+				}
+			}
+			
+			for (UInt j = 0; j < theNumSites; j++)
+			{
+				for (UInt n = j + 1; n < theNumSites; n++)
+				{
+					if ((j != i) and (n != i))
+						theMaxSumCov += sqrt ((double) mVarDist[j] * (double) mVarDist[n]);
+				}
+			}
+			IndexAssocFromDist (theDistArray, theSumVarDist, theMaxSumCov,
+				oIndexAssoc[i], oRBarD[i]);
+		}
+	}
+}
+
+
+// CALCULATE BOOTSTRAP
+// Confidence intervals for the number of genotypes, diversity, index of
+// association & rBarD, from resampling the isolates with replacement.
+// Each replicate is printed, then the percentile intervals. Replicates
+// for which a statistic can't be calculated (e.g. with no variation) are
+// left out of its interval.
+void MultiLocusModel::CalcBootstrap
+(UInt iNumReplicates, double iConfidence, ofstream& ioBootStream)
+{
+	assert ((0.0 < iConfidence) and (iConfidence < 1.0));
+	
+	StartPhases ();
+	ChooseRunSeed ();
+	
+	// 1. the observed data, as for CalcDiversity()
+	CalcVarDistances ();
+	InitBootstrapFile (ioBootStream);
+	double	theObserved[kBootStat_Size];
+	double	theIndexAssoc, theRBarD, theDiversity;
+	int		theNumDiff, theMaxFreq;
+	CalcNumDiff (theDiversity, theNumDiff, theMaxFreq);
+	CalcIndexAssocRBarD (theIndexAssoc, theRBarD);
+	theObserved[kBootStat_NumDiff] = theNumDiff;
+	theObserved[kBootStat_Diversity] = theDiversity;
+	theObserved[kBootStat_IndexAssoc] = theIndexAssoc;
+	theObserved[kBootStat_RBarD] = theRBarD;
+	
+	// 2. the replicates
+	MATRIX(double)	theStats;
+	StartProgress (kAnalysis_Bootstrap, 1, iNumReplicates, iNumReplicates,
+		kRandomProgressStep);
+	CalcBootstrapStats (iNumReplicates, theStats);
+	FinishProgress ();
+	
+	// 3. output every replicate & the intervals
+	{
+		ScopedPhase theOutputPhase (mProfile, kPhase_Output);
+		ioBootStream << "Observed";
+		for (int k = 0; k < kBootStat_Size; k++)
+			ioBootStream << "\t" << theObserved[k];
+		ioBootStream << endl;
+		for (UInt i = 0; i < iNumReplicates; i++)
+		{
+			ioBootStream << i + 1;
+			for (int k = 0; k < kBootStat_Size; k++)
+				ioBootStream << "\t" << theStats[i][k];
+			ioBootStream << endl;
+		}
+		
+		// the percentiles are those of the nearest rank
+		double theTail = (1.0 - iConfidence) / 2.0;
+		double theBounds[2] = { theTail, 1.0 - theTail };
+		ioBootStream << endl << "Intervals of " << toString (100.0 * iConfidence)
+			<< "%" << endl;
+		for (int b = 0; b < 2; b++)
+		{
+			ioBootStream << ((b == 0) ? "Lower" : "Upper");
+			for (int k = 0; k < kBootStat_Size; k++)
+			{
+				vector<double> theValues;
+				for (UInt i = 0; i < iNumReplicates; i++)
+				{
+					if (std::isfinite (theStats[i][k]))
+						theValues.push_back (theStats[i][k]);
+				}
+				ioBootStream << "\t";
+				if (theValues.empty())
+				{
+					ioBootStream << "N/A";
+					continue;
+				}
+				sort (theValues.begin(), theValues.end());
+				double theRank = std::ceil (theBounds[b] * theValues.size());
+				UInt theIndex = (theRank < 1.0) ? 0 : UInt (theRank) - 1;
+				ioBootStream << theValues[std::min (theIndex,
+					UInt (theValues.size() - 1))];
+			}
+			ioBootStream << endl;
+		}
+	}
+	
+	FinishPhases (kAnalysis_Bootstrap);
+}
+
+
+// RUN BOOTSTRAP REPLICATES
+// Work out every iStride'th replicate from iFirstRep to iLastRep, run as a
+// thread of CalcBootstrapStats(). Each replicate has its own generator,
+// seeded as for a randomization, so the results don't depend on how the
+// replicates are shared out.
+static void RunBootstrapReplicates (const BootstrapEngine* iEngine,
+	long iRunSeed, UInt iNumIso, UInt iFirstRep, UInt iLastRep, UInt iStride,
+	MATRIX(double)* oStats)
+{
+	RandomService	theRng;
+	vector<UInt>	theWeights;
+	BootstrapStats	theStats;
+	
+	for (UInt i = iFirstRep; i <= iLastRep; i += iStride)
+	{
+		theRng.SetSeed (ReplicateSeed (iRunSeed, i));
+		BootstrapEngine::DrawWeights (theRng, iNumIso, theWeights);
+		iEngine->Calc (theWeights, theStats);
+		
+		UInt theNumLoci = theStats.mVarDist.size();
+		double theSumVarDist = 0.0;
+		for (UInt j = 0; j < theNumLoci; j++)
+			theSumVarDist += theStats.mVarDist[j];
+		double theMaxSumCov = SumMaxCovariance (theStats.mVarDist, 0,
+			theNumLoci, theNumLoci);
+		
+		vector<double>& theRow = (*oStats)[i - 1];
+		theRow[kBootStat_NumDiff] = theStats.mNumDiff;
+		theRow[kBootStat_Diversity] = theStats.mDiversity;
+		IndexAssocFromVar (theStats.mVarDistObs, theSumVarDist, theMaxSumCov,
+			theRow[kBootStat_IndexAssoc], theRow[kBootStat_RBarD]);
+	}
+}
+
+
+// CALCULATE BOOTSTRAP STATISTICS
+// For each replicate, a row of the statistics in bootstat_t. The reference
+// engine copies the drawn isolates into the working data, each followed
+// by its copies, & works out the statistics as for CalcDiversity(). The
+// fast engine leaves the data alone & works them out from the weights of
+// the isolates (see BootstrapEngine.h), sharing the replicates between
+// mNumThreads threads, a batch at a time so that progress can be reported.
+void MultiLocusModel::CalcBootstrapStats (UInt iNumReplicates,
+	MATRIX(double)& oStats)
+{
+	ScopedPhase thePhase (mProfile, kPhase_Bootstrap);
+	UInt theNumIso = GetNumRows ();
+	UInt theNumLoci = GetNumCols ();
+	
+	oStats.assign (iNumReplicates, vector<double> (kBootStat_Size, 0.0));
+	
+	if (mEngine == kEngine_Fast)
+	{
+		PairDistArray theDists;
+		CalcPairDists (theDists);
+		BootstrapEngine theEngine (theDists, theNumIso, theNumLoci);
+		InitBootstrapEngine (theEngine, AllIndices (theNumIso));
+		
+		UInt theNumThreads = std::max (mNumThreads, 1U);
+		UInt theBatchSize = kRandomProgressStep * theNumThreads;
+		for (UInt theFirst = 1; theFirst <= iNumReplicates;
+			theFirst += theBatchSize)
+		{
+			UInt theLast = std::min (theFirst + theBatchSize - 1, iNumReplicates);
+			vector<thread> theThreads;
+			for (UInt t = 1; t < theNumThreads; t++)
+			{
+				theThreads.push_back (thread (RunBootstrapReplicates, &theEngine,
+					mRunSeed, theNumIso, theFirst + t, theLast, theNumThreads,
+					&oStats));
+			}
+			RunBootstrapReplicates (&theEngine, mRunSeed, theNumIso, theFirst,
+				theLast, theNumThreads, &oStats);
+			for (UInt t = 0; t < theThreads.size(); t++)
+				theThreads[t].join ();
+			
+			// batches are a whole number of reports long
+			if (mNextProgressRep <= theLast)
+			{
+				while (mNextProgressRep < theLast)
+					mNextProgressRep += mProgressStep;
+				if (mNextProgressRep == theLast)
+					ReportProgress (theLast);
+			}
+		}
+		return;
+	}
+	
+	// the backup may be in use by the caller, so keep a copy here
+	FlatMatrix<tAllele>		theHaploData;
+	FlatMatrix<tAllelePair>	theDiploData;
+	vector<UInt>			theLocusCodes = mLocusCodes;
+	if (GetPloidy() == kPloidy_Haploid)
+		theHaploData = mHaploData;
+	else
+		theDiploData = mDiploData;
+	
+	for (UInt i = 1; i <= iNumReplicates; i++)
+	{
+		vector<UInt> theWeights;
+		SeedReplicate (i);
+		BootstrapEngine::DrawWeights (mRng, theNumIso, theWeights);
+		
+		for (UInt j = 0, theRow = 0; j < theNumIso; j++)
+		{
+			for (UInt c = 0; c < theWeights[j]; c++, theRow++)
+			{
+				if (GetPloidy() == kPloidy_Haploid)
+					mHaploData.CopyRow (theRow, theHaploData, j);
+				else
+					mDiploData.CopyRow (theRow, theDiploData, j);
+				for (UInt m = 0; m < theNumLoci; m++)
+					mLocusCodes[(m * theNumIso) + theRow] =
+						theLocusCodes[(m * theNumIso) + j];
+			}
+		}
+		InitMissing ();
+		mIsGtypeStatsKnown = false;
+		
+		double	theDiversity, theIndexAssoc, theRBarD;
+		int		theNumDiff, theMaxFreq;
+		CalcVarDistances ();
+		CalcNumDiff (theDiversity, theNumDiff, theMaxFreq);
+		CalcIndexAssocRBarD (theIndexAssoc, theRBarD);
+		oStats[i - 1][kBootStat_NumDiff] = theNumDiff;
+		oStats[i - 1][kBootStat_Diversity] = theDiversity;
+		oStats[i - 1][kBootStat_IndexAssoc] = theIndexAssoc;
+		oStats[i - 1][kBootStat_RBarD] = theRBarD;
+		
+		if (i == mNextProgressRep)
+			ReportProgress (i);
+	}
+	if (GetPloidy() == kPloidy_Haploid)
+		mHaploData = theHaploData;
+	else
+		mDiploData = theDiploData;
+	mLocusCodes = theLocusCodes;
+	InitMissing ();
+	mIsGtypeStatsKnown = false;
+	CalcVarDistances ();
 }
 
 
@@ -1705,6 +3284,7 @@ void MultiLocusModel::CalcDiversity
 void MultiLocusModel::
 CalcIsoDistArray (vector<int>& oDistArray, distance_t iIsDistStrict)
 {
+	ScopedPhase thePhase (mProfile, kPhase_IsoDistArray);
 	int			theNumIso = GetNumRows ();
 	int			theNumSites = GetNumCols ();
 	long			thePairNum = 0;
@@ -1712,6 +3292,8 @@ CalcIsoDistArray (vector<int>& oDistArray, distance_t iIsDistStrict)
 	oDistArray.clear();
 	oDistArray.resize(mNumPairsIsolates,0);
 	
+	// CHANGE: the fast engine uses CalcPairDists() instead.
+	
 	// for every pair of isolates ...
 	for (int i = 0; i < theNumIso - 1; i++ )
 	{
@@ -1724,16 +3306,16 @@ CalcIsoDistArray (vector<int>& oDistArray, distance_t iIsDistStrict)
 				if (iIsDistStrict == kDistance_Relaxed)
 				{
 					theDist = (GetPloidy() == kPloidy_Haploid) ?
-						Distance ((*mHaploData)[i][k], (*mHaploData)[j][k]) :
-						Distance ((*mDiploData)[i][k], (*mDiploData)[j][k]);
+						Distance (mHaploData[i][k], mHaploData[j][k]) :
+						Distance (mDiploData[i][k], mDiploData[j][k]);
 				}
 				else
 				{
 					assert (iIsDistStrict == kDistance_Strict);
 					
 					theDist = (GetPloidy() == kPloidy_Haploid) ?
-						StrictDistance ((*mHaploData)[i][k], (*mHaploData)[j][k]) :
-						StrictDistance ((*mDiploData)[i][k], (*mDiploData)[j][k]);
+						StrictDistance (mHaploData[i][k], mHaploData[j][k]) :
+						StrictDistance (mDiploData[i][k], mDiploData[j][k]);
 				}
 				
 				oDistArray[thePairNum] += theDist;
@@ -1745,6 +3327,72 @@ CalcIsoDistArray (vector<int>& oDistArray, distance_t iIsDistStrict)
 }
 
 
+// CALCULATE PAIR DISTANCES
+// As CalcIsoDistArray(), for the fast engine, which asks the ploidy once
+// rather than for every cell & holds the distances as narrow as the
+// number of loci allows.
+void MultiLocusModel::
+CalcPairDists (PairDistArray& oDists, distance_t iIsDistStrict)
+{
+	ScopedPhase thePhase (mProfile, kPhase_IsoDistArray);
+	vector<UInt> theLoci = AllIndices (GetNumCols());
+	
+	oDists.Reset (mNumPairsIsolates, GetMaxLocusDist() * GetNumCols());
+	if (GetPloidy() == kPloidy_Diploid)
+		oDists.AddLoci (mDiploData, theLoci, DiplotypeMetric (mNumLocusDTypes,
+			(iIsDistStrict == kDistance_Relaxed) ? mLocusDTypeDists :
+			mLocusDTypeStrictDists));
+	else if (iIsDistStrict == kDistance_Relaxed)
+		oDists.AddLoci (mHaploData, theLoci, RelaxedMetric<HaploidPolicy>());
+	else
+		oDists.AddLoci (mHaploData, theLoci, StrictMetric<HaploidPolicy>());
+}
+
+
+// STREAM PAIR DISTANCES
+// Give the (relaxed) distances over the given loci between every pair of
+// isolates to a reducer, without holding them (see PloidyPolicy.h). For
+// the fast engine, where a statistic needs no more than the reducer
+// keeps, so memory is not the square of the number of isolates.
+template <typename REDUCER>
+void MultiLocusModel::
+StreamPairDists (const vector<UInt>& iLoci, REDUCER& ioReducer)
+{
+	ScopedPhase thePhase (mProfile, kPhase_IsoDistArray);
+	if (GetPloidy() == kPloidy_Diploid)
+		StreamIsoDistances (mDiploData, iLoci, DiplotypeMetric (mNumLocusDTypes,
+			mLocusDTypeDists), ioReducer);
+	else
+		StreamIsoDistances (mHaploData, iLoci, RelaxedMetric<HaploidPolicy>(),
+			ioReducer);
+}
+
+
+// GET MAXIMUM LOCUS DISTANCE
+// The largest distance between two isolates at a single locus.
+UInt MultiLocusModel::GetMaxLocusDist ()
+{
+	return (GetPloidy() == kPloidy_Diploid) ? 2 : 1;
+}
+
+
+// ADD LOCUS TO DISTANCE ARRAY
+// Add the (relaxed) distances at a single locus to an isolate-pair
+// distance array, or with a weight of -1 take them away.
+void MultiLocusModel::
+AddLocusToDistArray (UInt iLocus, int iWeight, PairDistArray& ioDists)
+{
+	assert (ioDists.size() == mNumPairsIsolates);
+	
+	if (GetPloidy() == kPloidy_Diploid)
+		ioDists.AddLocus (mDiploData, iLocus, DiplotypeMetric (mNumLocusDTypes,
+			mLocusDTypeDists), iWeight);
+	else
+		ioDists.AddLocus (mHaploData, iLocus, RelaxedMetric<HaploidPolicy>(),
+			iWeight);
+}
+
+
 // COUNT GENOTYPES FROM DISTANCES
 // Given an isolate-pair distance array (as generated by CalcIsoDistArray())
 // count the number of unique genotypes. Note the answer will vary based on
@@ -1817,6 +3465,149 @@ double MultiLocusModel::CalcDivFromDist (vector<int>& oDistArray)
 }
 
 
+// FIND GENOTYPES
+// The first isolate of each distinct genotype & the number of isolates
+// that share it. Only complete isolates are merged, as with missing data
+// "identical" isn't transitive (see CalcNumDiff()), so each isolate that
+// is missing data is a genotype of its own. Returns whether any isolates
+// were merged.
+bool MultiLocusModel::FindGenotypes (vector<UInt>& oRows,
+	vector<UInt>& oWeights)
+{
+	UInt theNumIso = GetNumRows ();
+	UInt theNumLoci = GetNumCols ();
+	unordered_map<string,UInt> theGtypes;
+	
+	oRows.clear ();
+	oWeights.clear ();
+	for (UInt i = 0; i < theNumIso; i++)
+	{
+		// a key for the row, alleles as they are or diplotypes as bytes
+		string	theKey;
+		bool		theIsComplete = true;
+		for (UInt j = 0; (j < theNumLoci) and theIsComplete; j++)
+		{
+			if (GetPloidy() == kPloidy_Haploid)
+			{
+				const tAllele& theCell = mHaploData[i][j];
+				theIsComplete = not IsMissing (i, j);
+				theKey += theCell;
+				theKey += '\t';
+			}
+			else
+			{
+				const tAllelePair& theCell = mDiploData[i][j];
+				theIsComplete = not IsMissing (i, j);
+				theKey.append ((const char*) &theCell.dtypeId, sizeof (UInt));
+			}
+		}
+		
+		if (theIsComplete)
+		{
+			pair<unordered_map<string,UInt>::iterator,bool> theMatch =
+				theGtypes.insert (make_pair (theKey, (UInt) oRows.size()));
+			if (not theMatch.second)
+			{
+				oWeights[theMatch.first->second]++;
+				continue;
+			}
+		}
+		oRows.push_back (i);
+		oWeights.push_back (1);
+	}
+	
+	return (oRows.size() < theNumIso);
+}
+
+
+// CALCULATE GENOTYPE STATISTICS
+// Where complete isolates share genotypes, the number of genotypes,
+// diversity & variances of distances can be had from the distinct
+// genotypes alone, each weighted by the number of isolates that share it
+// (see BootstrapEngine.h). For data of a few clones sampled many times
+// this is far quicker than going over every pair of isolates. Returns
+// false, having done nothing more than look, if no isolates share a
+// genotype or the engine is the reference. The statistics are kept until
+// the data changes, as the number of genotypes & the index of
+// association both ask for them.
+bool MultiLocusModel::CalcGenotypeStats (BootstrapStats& oStats)
+{
+	if (mEngine != kEngine_Fast)
+		return false;
+	if (mIsGtypeStatsKnown)
+	{
+		if (mHasGtypeStats)
+			oStats = mGtypeStats;
+		return mHasGtypeStats;
+	}
+	
+	ScopedPhase thePhase (mProfile, kPhase_Genotypes);
+	vector<UInt> theRows, theWeights;
+	mIsGtypeStatsKnown = true;
+	mHasGtypeStats = FindGenotypes (theRows, theWeights);
+	if (not mHasGtypeStats)
+		return false;
+	
+	PairDistArray theDists;
+	UInt theMaxDist = GetMaxLocusDist() * GetNumCols();
+	if (GetPloidy() == kPloidy_Diploid)
+		theDists.SumRows (mDiploData, theRows, theMaxDist, DiplotypeMetric
+			(mNumLocusDTypes, mLocusDTypeDists));
+	else
+		theDists.SumRows (mHaploData, theRows, theMaxDist,
+			RelaxedMetric<HaploidPolicy>());
+	
+	BootstrapEngine theEngine (theDists, theRows.size(), GetNumCols());
+	InitBootstrapEngine (theEngine, theRows);
+	theEngine.Calc (theWeights, mGtypeStats);
+	oStats = mGtypeStats;
+	return true;
+}
+
+
+// ESTIMATE VARIANCE OF DISTANCES
+// The variance of distances over all loci estimated from pairs of
+// isolates drawn at random, the sample doubling until its standard error
+// is within mPairSampleError of the estimate. Returns false if the sample
+// would have to be more than half of all pairs, when every pair may as
+// well be used. As the pairs come from a stream of their own, every
+// replicate, shard & resumed run on data of one size is measured on the
+// same pairs.
+bool MultiLocusModel::EstimateVarDist (PairSample& oSample)
+{
+	assert (0.0 < mPairSampleError);
+	ScopedPhase		thePhase (mProfile, kPhase_PairSample);
+	RandomService	theRng (kPairSampleSeed);
+	long				theNumIso = GetNumRows ();
+	vector<UInt>	thePairs;
+	
+	for (ulong theSize = kFirstPairSample; theSize <= mNumPairsIsolates / 2;
+		theSize *= 2)
+	{
+		while (thePairs.size() < 2 * theSize)
+		{
+			UInt theIso1 = theRng.UniformWhole (theNumIso);
+			UInt theIso2 = theRng.UniformWhole (theNumIso - 1);
+			if (theIso1 <= theIso2)
+				theIso2++;
+			thePairs.push_back (theIso1);
+			thePairs.push_back (theIso2);
+		}
+		
+		if (GetPloidy() == kPloidy_Diploid)
+			SampleVarDist (mDiploData, thePairs, DiplotypeMetric (mNumLocusDTypes,
+				mLocusDTypeDists), oSample);
+		else
+			SampleVarDist (mHaploData, thePairs, RelaxedMetric<HaploidPolicy>(),
+				oSample);
+		
+		if (oSample.mVarDistError <= mPairSampleError * oSample.mVarDist)
+			return true;
+	}
+	return false;
+}
+
+
 // CALC NUM DIFF
 // !! ... and gMaxFreq and gDiver. Compare every isolate to those before
 // them. The isolates array contains a number for each isolate that says
@@ -1856,20 +3647,50 @@ double MultiLocusModel::CalcDivFromDist (vector<int>& oDistArray)
 void MultiLocusModel::CalcNumDiff (double& iDiversity, int& iNumDiff,
 	int& iMaxFreq)
 {
-	vector<int> theIsoDistArray;
-	CalcIsoDistArray (theIsoDistArray, kDistance_Relaxed);
-	// DBG_VECTOR(&theIsoDistArray);
+	ScopedPhase thePhase (mProfile, kPhase_NumDiff);
 	
-	iNumDiff = CountGtypesFromDist (theIsoDistArray);
+	// CHANGE: the fast engine works from the distinct genotypes, if any
+	// isolates share one. Each is counted where its first isolate is, as
+	// the others would all join whichever genotype that one joins.
+	BootstrapStats theGtypeStats;
+	if (CalcGenotypeStats (theGtypeStats))
+	{
+		iNumDiff = theGtypeStats.mNumDiff;
+		iMaxFreq = theGtypeStats.mMaxFreq;
+		iDiversity = theGtypeStats.mDiversity;
+		return;
+	}
+	
+	// CHANGE: the fast engine streams the distances through reducers
+	// rather than holding them.
 	vector<int> theGtypeFreqArray;
-	CountFreqsFromDist (theIsoDistArray, theGtypeFreqArray);
+	if (mEngine == kEngine_Fast)
+	{
+		ZeroPairClusters theClusters (GetNumRows());
+		PairMoments theMoments;
+		BothReducers<ZeroPairClusters,PairMoments> theReducers (theClusters,
+			theMoments);
+		StreamPairDists (AllIndices (GetNumCols()), theReducers);
+		theGtypeFreqArray = theClusters.GetFreqs();
+		iNumDiff = theClusters.CountGtypes();
+		iDiversity = theMoments.mNumDiffPairs / theMoments.mNumPairs;
+	}
+	else
+	{
+		vector<int> theIsoDistArray;
+		CalcIsoDistArray (theIsoDistArray, kDistance_Relaxed);
+		// DBG_VECTOR(&theIsoDistArray);
+		
+		iNumDiff = CountGtypesFromDist (theIsoDistArray);
+		CountFreqsFromDist (theIsoDistArray, theGtypeFreqArray);
+		iDiversity = CalcDivFromDist (theIsoDistArray);
+	}
 	iMaxFreq = 0;
 	for (int i = 0; i < (int) theGtypeFreqArray.size(); i++)
 	{
 		if (iMaxFreq < theGtypeFreqArray[i])
 			iMaxFreq = theGtypeFreqArray[i];
 	}
-	iDiversity = CalcDivFromDist (theIsoDistArray);
 
 	assert (0 < iMaxFreq);
 	assert (0 < iDiversity);
@@ -1886,10 +3707,76 @@ void MultiLocusModel::CalcNumDiff (double& iDiversity, int& iNumDiff,
 // !! Looks good.
 void MultiLocusModel::CalcPorpCompat (double& iPorpCompat)
 {
+	ScopedPhase thePhase (mProfile, kPhase_PorpCompat);
 	long	theNumIncompat = 0;
 	int	theNumSites = GetNumCols ();
 	int	theNumIso = GetNumRows ();
 	
+	// CHANGE: the fast engine collects the genotypes of each pair of sites
+	// from the locus codes, as pairs of allele numbers, in the order the
+	// reference does.
+	if (mEngine == kEngine_Fast)
+	{
+		vector< pair<UInt,UInt> >	theGenotypes;
+		vector<uchar>					theIsSeen;
+		for (int i = 0; i < theNumSites - 1; i++)
+		{
+			const UInt*				theCodes1 = GetLocusCodes (i);
+			const vector<UInt>&	theAlleles1 = mLocusClassAlleles[i];
+			for (int j = i + 1; j < theNumSites; j++)
+			{
+				const UInt*				theCodes2 = GetLocusCodes (j);
+				const vector<UInt>&	theAlleles2 = mLocusClassAlleles[j];
+				UInt						theNumAlleles2 = mNumLocusAlleles[j];
+				
+				theGenotypes.clear ();
+				theIsSeen.assign (mNumLocusAlleles[i] * theNumAlleles2, 0);
+				for (int k = 0; k < theNumIso; k++)
+				{
+					UInt theA1 = theAlleles1[2 * theCodes1[k]];
+					UInt theB1 = theAlleles1[(2 * theCodes1[k]) + 1];
+					UInt theA2 = theAlleles2[2 * theCodes2[k]];
+					UInt theB2 = theAlleles2[(2 * theCodes2[k]) + 1];
+					if ((theA1 == 0) or (theB1 == 0) or (theA2 == 0) or (theB2 == 0))
+						continue;
+					
+					// diploid genotypes are split as in the reference, last first
+					pair<UInt,UInt> theNew[2];
+					int theNumNew = 0;
+					if (GetPloidy() == kPloidy_Haploid)
+						theNew[theNumNew++] = make_pair (theA1, theA2);
+					else if (theA1 == theB1)
+					{
+						theNew[theNumNew++] = make_pair (theA1, theB2);
+						theNew[theNumNew++] = make_pair (theA1, theA2);
+					}
+					else if (theA2 == theB2)
+					{
+						theNew[theNumNew++] = make_pair (theB1, theA2);
+						theNew[theNumNew++] = make_pair (theA1, theA2);
+					}
+					for (int m = 0; m < theNumNew; m++)
+					{
+						uchar& theSeen = theIsSeen[(theNew[m].first * theNumAlleles2) +
+							theNew[m].second];
+						if (not theSeen)
+						{
+							theSeen = 1;
+							theGenotypes.push_back (theNew[m]);
+						}
+					}
+				}
+				
+				if (not AreGenotypesCompatible (theGenotypes))
+					theNumIncompat++;
+			}
+		}
+		
+		iPorpCompat = (double) (mNumPairsSites - theNumIncompat) /
+			(double) mNumPairsSites;
+		return;
+	}
+	
 	// !! for every unique pair of sites - by matching every site (but the 
 	// last) with every site after it in the order of isolates.
 	for (int i = 0; i < theNumSites - 1; i++)
@@ -1914,8 +3801,8 @@ void MultiLocusModel::CalcPorpCompat (double& iPorpCompat)
 					if (GetPloidy() == kPloidy_Haploid)
 					{
 						vector<tAllele>	theSitePair;
-						theSitePair.push_back ((*mHaploData)[k][i]);
-						theSitePair.push_back ((*mHaploData)[k][j]);
+						theSitePair.push_back (mHaploData[k][i]);
+						theSitePair.push_back (mHaploData[k][j]);
 						theNewGenotypes.push_back (theSitePair);
 					}
 					else
@@ -1927,21 +3814,21 @@ void MultiLocusModel::CalcPorpCompat (double& iPorpCompat)
 						if (IsHomozygous (k,i))
 						{
 							vector<tAllele>	theSitePair;
-							theSitePair.push_back ((*mDiploData)[k][i].alleleA);
-							theSitePair.push_back ((*mDiploData)[k][j].alleleA);
+							theSitePair.push_back (mDiploData[k][i].alleleA);
+							theSitePair.push_back (mDiploData[k][j].alleleA);
 							theNewGenotypes.push_back (theSitePair);
-							theSitePair[0] = (*mDiploData)[k][i].alleleA;
-							theSitePair[1] = (*mDiploData)[k][j].alleleB;
+							theSitePair[0] = mDiploData[k][i].alleleA;
+							theSitePair[1] = mDiploData[k][j].alleleB;
 							theNewGenotypes.push_back (theSitePair);
 						}
 						else if (IsHomozygous (k,j))
 						{
 							vector<tAllele>	theSitePair;
-							theSitePair.push_back ((*mDiploData)[k][i].alleleA);
-							theSitePair.push_back ((*mDiploData)[k][j].alleleA);
+							theSitePair.push_back (mDiploData[k][i].alleleA);
+							theSitePair.push_back (mDiploData[k][j].alleleA);
 							theNewGenotypes.push_back (theSitePair);
-							theSitePair[0] = (*mDiploData)[k][i].alleleB;
-							theSitePair[1] = (*mDiploData)[k][j].alleleA;
+							theSitePair[0] = mDiploData[k][i].alleleB;
+							theSitePair[1] = mDiploData[k][j].alleleA;
 							theNewGenotypes.push_back (theSitePair);
 						}
 					}
@@ -2066,19 +3953,55 @@ void MultiLocusModel::CalcPorpCompat (double& iPorpCompat)
 // !! Note: implemetation differs from that in haploshuffle original.
 void MultiLocusModel::CalcIndexAssocRBarD (double& oIndexAssoc, double& oRBarD)
 {
+	ScopedPhase thePhase (mProfile, kPhase_IndexAssoc);
 	// create and init array for storing distances
 	int			theNumIso = GetNumRows ();
 	int			theNumSites = GetNumCols ();
 	vector<int>	theSumDistArray;
 	long			thePairNum = 0;
 	
-	CalcIsoDistArray (theSumDistArray, kDistance_Relaxed);
-
+	// CHANGE: for very large data, the observed variance can be estimated
+	// from a sample of pairs. Its standard error is passed on, taking the
+	// expected variance as known.
+	PairSample theSample;
+	mIndexAssocError = mRBarDError = 0.0;
+	if ((0.0 < mPairSampleError) and EstimateVarDist (theSample))
+	{
+		IndexAssocFromVar (theSample.mVarDist, mSumVarDist, mMaxSumCov1,
+			oIndexAssoc, oRBarD);
+		mIndexAssocError = theSample.mVarDistError / mSumVarDist;
+		mRBarDError = theSample.mVarDistError / (2 * mMaxSumCov1);
+		return;
+	}
+	
+	// CHANGE: the fast engine works from the distinct genotypes, if any
+	// isolates share one.
+	BootstrapStats theGtypeStats;
+	if (CalcGenotypeStats (theGtypeStats))
+	{
+		IndexAssocFromVar (theGtypeStats.mVarDistObs, mSumVarDist, mMaxSumCov1,
+			oIndexAssoc, oRBarD);
+		return;
+	}
+	
+	// CHANGE: the fast engine needs only the sums of the distances, so
+	// streams them rather than holding them.
 	double theSumDist = 0, theSumDistSq = 0;
-	for (int i = 0; i < (int) mNumPairsIsolates; i++)
+	if (mEngine == kEngine_Fast)
 	{
-		theSumDist += theSumDistArray[i];
-		theSumDistSq += theSumDistArray[i] * theSumDistArray[i];
+		PairMoments theMoments;
+		StreamPairDists (AllIndices (GetNumCols()), theMoments);
+		theSumDist = theMoments.mSumDist;
+		theSumDistSq = theMoments.mSumDistSq;
+	}
+	else
+	{
+		CalcIsoDistArray (theSumDistArray, kDistance_Relaxed);
+		for (int i = 0; i < (int) mNumPairsIsolates; i++)
+		{
+			theSumDist += theSumDistArray[i];
+			theSumDistSq += theSumDistArray[i] * theSumDistArray[i];
+		}
 	}
 	
 	// !! Calculate the observed variance of distances. theVarDistObs2
@@ -2114,6 +4037,7 @@ void MultiLocusModel::CalcIndexAssocRBarD (double& oIndexAssoc, double& oRBarD)
 // CHANGE: Fixed for diploid data.
 void MultiLocusModel::OutputAsPaup (ofstream& iPaupStream)
 {
+	ScopedPhase thePhase (mProfile, kPhase_Output);
 	assert (iPaupStream);
 	
 	for (int i = 0; i < (int) GetNumRows(); i++)
@@ -2124,7 +4048,8 @@ void MultiLocusModel::OutputAsPaup (ofstream& iPaupStream)
 			if (GetPloidy() == kPloidy_Haploid)
 				iPaupStream << GetDataString (i, j);
 			else
-				iPaupStream << ((*mDiploData)[i][j]).transNumDTypes << " ";
+				iPaupStream << GenerateDTypeSymbol
+					((mDiploData[i][j]).transNumDTypes) << " ";
 		}
 		iPaupStream << endl;
 	}
@@ -2141,14 +4066,14 @@ void MultiLocusModel::OutputAsPaup (ofstream& iPaupStream)
 		
 		iPaupStream << '\t';
 		for (int i = 0; i < theNumDipTypes; i++ )
-			iPaupStream << mDiploTrans[i].transNumDTypes << " ";
+			iPaupStream << GenerateDTypeSymbol (i) << " ";
 		iPaupStream << endl;
 		
 		for (int i = 0; i < theNumDipTypes; i++ )
 		{
 			iPaupStream << '\t';
 			for (int j = 0; j < theNumDipTypes; j++ )
-				iPaupStream << mStepMatrix[i][j] << " ";
+				iPaupStream << (int) mStepMatrix[(i * theNumDipTypes) + j] << " ";
 			iPaupStream << endl;
 		}
 		iPaupStream << "\t;" << endl;
@@ -2168,7 +4093,8 @@ void MultiLocusModel::OutputAsPaup (ofstream& iPaupStream)
 // called gSumVar1). Works for > 2 alleles, missing data and diploid.
 void MultiLocusModel::CalcVarDistances()
 {	
-	long theSumDist, theSumSquares;
+	ScopedPhase thePhase (mProfile, kPhase_VarDistances);
+	double theSumDist, theSumSquares;
 	int theNumSites = GetNumCols ();
 	int theNumIso = GetNumRows ();
 	
@@ -2177,31 +4103,49 @@ void MultiLocusModel::CalcVarDistances()
 	mSumVarDist = 0.0;
 	
 	// for every loci ...
+	vector<UInt> theIsolates = AllIndices (theNumIso);
 	for (int i = 0; i < theNumSites; i++)
 	{
 		theSumDist = theSumSquares = 0;
 		
-		// for every unique pair of isolates
-		for (int k = 0; k < (theNumIso - 1); k++)
+		// CHANGE: the distances at a locus depend only on the alleles (or
+		// diplotypes) of the pair, so the fast engine counts the isolates
+		// of each & sums over pairs of those. As this is exact & O(n), it
+		// is used whenever the variance over all loci is being estimated
+		// from sampled pairs, whatever the engine.
+		if ((mEngine == kEngine_Fast) or (0.0 < mPairSampleError))
 		{
-			for (int m = k + 1; m < theNumIso; m++)
-			{ 
-				ASSERT_VALIDINDEX(k,i);
-				ASSERT_VALIDINDEX(m,i);
-
-				// sum the distances and squares of distances
-				int theDistance = (GetPloidy() == kPloidy_Haploid)
-					? Distance ((*mHaploData)[k][i], (*mHaploData)[m][i])
-					: Distance ((*mDiploData)[k][i], (*mDiploData)[m][i]);
-			
-				theSumDist += theDistance;
-				theSumSquares += (theDistance * theDistance);
+			vector<UInt>	theClasses;
+			vector<uchar>	theClassDists;
+			UInt theNumClasses = NumberLocusClasses (i, theIsolates, theClasses,
+				theClassDists);
+			ClassDistanceMoments (theClasses, theNumClasses, theClassDists,
+				theSumDist, theSumSquares);
+		}
+		else
+		{
+			// for every unique pair of isolates
+			for (int k = 0; k < (theNumIso - 1); k++)
+			{
+				for (int m = k + 1; m < theNumIso; m++)
+				{ 
+					ASSERT_VALIDINDEX(k,i);
+					ASSERT_VALIDINDEX(m,i);
+	
+					// sum the distances and squares of distances
+					int theDistance = (GetPloidy() == kPloidy_Haploid)
+						? Distance (mHaploData[k][i], mHaploData[m][i])
+						: Distance (mDiploData[k][i], mDiploData[m][i]);
+				
+					theSumDist += theDistance;
+					theSumSquares += (theDistance * theDistance);
+				}
 			}
 		}
 		
-		mVarDist[i] = ((double) theSumSquares - ((double)
-			(theSumDist * theSumDist) / (double) mNumPairsIsolates)) /
-			(double) mNumPairsIsolates;
+		// CHANGE: the sums are doubles, so the square can't overflow
+		mVarDist[i] = (theSumSquares - ((theSumDist * theSumDist) /
+			(double) mNumPairsIsolates)) / (double) mNumPairsIsolates;
 		mSumVarDist += mVarDist[i];
 	}
 	
@@ -2228,6 +4172,7 @@ void MultiLocusModel::CalcVarDistances()
 // !! Looks right. 
 void MultiLocusModel::PrepRBarSCalc()
 {
+	ScopedPhase thePhase (mProfile, kPhase_PrepRBarS);
 	vector<double>		theVarSites (GetNumCols());
 	
 	mSumVar2 = mMaxSumCov2 = 0.0;
@@ -2242,14 +4187,16 @@ void MultiLocusModel::PrepRBarSCalc()
 		for (int k = 0; k < (int) GetNumRows(); k++)
 		{
 			long theSiteDataValue;
-			if (GetPloidy() == kPloidy_Haploid)	// haplo
+			if (mEngine == kEngine_Fast)
+				theSiteDataValue = mRanks[(k * GetNumCols()) + i];
+			else if (GetPloidy() == kPloidy_Haploid)	// haplo
 			{
-				theSiteDataValue = String2Int ((*mHaploData)[k][i]);
+				theSiteDataValue = String2Int (mHaploData[k][i]);
 			}
 			else										// diplo
 			{
-				theSiteDataValue = String2Int ((*mDiploData)[k][i].alleleA)
-					+ String2Int ((*mDiploData)[k][i].alleleB);
+				theSiteDataValue = String2Int (mDiploData[k][i].alleleA)
+					+ String2Int (mDiploData[k][i].alleleB);
 			}
 			assert (theSiteDataValue >= 0);
 			
@@ -2279,47 +4226,60 @@ void MultiLocusModel::PrepRBarSCalc()
 
 void MultiLocusModel::CalcRBarS (double& oRBarS)
 {
+	ScopedPhase thePhase (mProfile, kPhase_RBarS);
 	long	theSumRanks = 0, theSumSqRanks = 0;
 	int	theNumIso = GetNumRows();
 	
-	// for every isolate ...
-	for (int i = 0; i < theNumIso; i++)
+	// CHANGE: the fast engine has the sums of ranks at hand
+	if (mEngine == kEngine_Fast)
 	{
-		long theSumCharRank = 0;
-		
-		// !! for every site in that isolate, extract the rank of the 
-		// character at the site, sum it.
-		for (int j = 0; j < (int) GetNumCols(); j++)
+		for (int i = 0; i < theNumIso; i++)
 		{
-			int theCharRank;
-			// at length, for edification and debugging
-			if (GetPloidy () == kPloidy_Haploid)
-			{
-				if (IsMissing (i,j))
-					theCharRank = 0;
-				else
-					theCharRank = String2Int ((*mHaploData)[i][j]);
-			}
-			else
+			theSumRanks += mIsoRankSums[i];
+			theSumSqRanks += mIsoRankSums[i] * mIsoRankSums[i];
+		}
+	}
+	else
+	{
+		// for every isolate ...
+		for (int i = 0; i < theNumIso; i++)
+		{
+			long theSumCharRank = 0;
+		
+			// !! for every site in that isolate, extract the rank of the 
+			// character at the site, sum it.
+			for (int j = 0; j < (int) GetNumCols(); j++)
 			{
-				if (IsMissing ((*mDiploData)[i][j].alleleA))
-					theCharRank = 0;
+				int theCharRank;
+				// at length, for edification and debugging
+				if (GetPloidy () == kPloidy_Haploid)
+				{
+					if (IsMissing (i,j))
+						theCharRank = 0;
+					else
+						theCharRank = String2Int (mHaploData[i][j]);
+				}
 				else
-					theCharRank = String2Int ((*mDiploData)[i][j].alleleA);
+				{
+					if (IsMissing (mDiploData[i][j].alleleA))
+						theCharRank = 0;
+					else
+						theCharRank = String2Int (mDiploData[i][j].alleleA);
 					
-				if (IsMissing ((*mDiploData)[i][j].alleleB))
-					theCharRank += 0;
-				else
-					theCharRank += String2Int ((*mDiploData)[i][j].alleleB);
-			}
+					if (IsMissing (mDiploData[i][j].alleleB))
+						theCharRank += 0;
+					else
+						theCharRank += String2Int (mDiploData[i][j].alleleB);
+				}
 			
-			assert (theCharRank >= 0);
-			theSumCharRank += theCharRank;
-		}
+				assert (theCharRank >= 0);
+				theSumCharRank += theCharRank;
+			}
 		
-		// sum it and sum the squares ...
-		theSumRanks += theSumCharRank;
-		theSumSqRanks += theSumCharRank * theSumCharRank;
+			// sum it and sum the squares ...
+			theSumRanks += theSumCharRank;
+			theSumSqRanks += theSumCharRank * theSumCharRank;
+		}
 	}
 	
 	double theVarSum2 = ((double) theSumSqRanks - (double) theSumRanks /
@@ -2355,12 +4315,12 @@ void MultiLocusModel::CalcVarSimilarityCoeff ()
   		{
 	  		if (GetPloidy() == kPloidy_Haploid)
 			{
-				theCharCount.Increment ((*mHaploData)[k][i]);
+				theCharCount.Increment (mHaploData[k][i]);
 			}
 			else
 			{
-				theCharCount.Increment ((*mDiploData)[k][i].alleleA);
-				theCharCount.Increment ((*mDiploData)[k][i].alleleB);
+				theCharCount.Increment (mDiploData[k][i].alleleA);
+				theCharCount.Increment (mDiploData[k][i].alleleB);
   			}
 		}
 		
@@ -2415,10 +4375,24 @@ void MultiLocusModel::CalcVarSimilarityCoeff ()
 void MultiLocusModel::CalcPairwiseStats (ofstream& oOutStream,
 	vector<double>& oPairwiseRVals, vector<double>& oPVals, bool iIsOriginalData)
 {	
+	ScopedPhase thePhase (mProfile, kPhase_Pairwise);
 	// actually do the calculations (for every randomization)
 	int	theSitePr = 0;
 	int	theNumSites = GetNumCols();
 	
+	// CHANGE: the fast engine finds the distances at each locus once, not
+	// once for every pair of loci it is in, & then all the pairs at once.
+	LocusDistanceBits theLocusDists;
+	if (mEngine == kEngine_Fast)
+	{
+		if (GetPloidy() == kPloidy_Haploid)
+			theLocusDists.Fill (mHaploData, RelaxedMetric<HaploidPolicy>());
+		else
+			theLocusDists.Fill (mDiploData,
+				DiplotypeMetric (mNumLocusDTypes, mLocusDTypeDists));
+		theLocusDists.CalcCrossProducts ();
+	}
+	
 	for (int i = 0; i < theNumSites - 1; i++) 
 	{		
 		for (int j = i + 1; j < theNumSites; j++)
@@ -2438,33 +4412,40 @@ void MultiLocusModel::CalcPairwiseStats (ofstream& oOutStream,
 				double theSumDist = 0;
 				double theSumSqDist = 0;
 				
-				for (int k = 1; k < (int) GetNumRows(); k++)
+				if (mEngine == kEngine_Fast)
+				{
+					theLocusDists.PairMoments (i, j, theSumDist, theSumSqDist);
+				}
+				else
 				{
-					for (int m = 0; m < k; m++)
+					for (int k = 1; k < (int) GetNumRows(); k++)
 					{
-						ASSERT_VALIDINDEX(k,i);
-						ASSERT_VALIDINDEX(m,i);
-						ASSERT_VALIDINDEX(k,j);
-						ASSERT_VALIDINDEX(m,j);
+						for (int m = 0; m < k; m++)
+						{
+							ASSERT_VALIDINDEX(k,i);
+							ASSERT_VALIDINDEX(m,i);
+							ASSERT_VALIDINDEX(k,j);
+							ASSERT_VALIDINDEX(m,j);
 
-						int theDist;
+							int theDist;
 						
-						if (GetPloidy() == kPloidy_Haploid)
-						{
-							theDist = Distance((*mHaploData)[k][i], (*mHaploData)[m][i])
-								+ Distance((*mHaploData)[k][j], (*mHaploData)[m][j]);
-						}
-						else
-						{
-							assert (GetPloidy() == kPloidy_Diploid);
-							theDist = Distance((*mDiploData)[k][i], (*mDiploData)[m][i])
-								+ Distance((*mDiploData)[k][j], (*mDiploData)[m][j]);
-						}
+							if (GetPloidy() == kPloidy_Haploid)
+							{
+								theDist = Distance(mHaploData[k][i], mHaploData[m][i])
+									+ Distance(mHaploData[k][j], mHaploData[m][j]);
+							}
+							else
+							{
+								assert (GetPloidy() == kPloidy_Diploid);
+								theDist = Distance(mDiploData[k][i], mDiploData[m][i])
+									+ Distance(mDiploData[k][j], mDiploData[m][j]);
+							}
 						
-						theSumDist += theDist;
-						theSumSqDist += (theDist * theDist);
-					}
-				} 
+							theSumDist += theDist;
+							theSumSqDist += (theDist * theDist);
+						}
+					} 
+				}
 				
 				double theVar = (theSumSqDist - theSumDist
 					/ double(mNumPairsIsolates) * theSumDist)
@@ -2529,6 +4510,7 @@ UInt MultiLocusModel::FindPartsLoop
 {
 	// preconditions
 	assert (GetPloidy() == kPloidy_Haploid);
+	StartPhases ();
 	
 	// Print header
 	ioPartStream << "Testing for Partitions, Observed Data:" << endl;
@@ -2546,36 +4528,43 @@ UInt MultiLocusModel::FindPartsLoop
 	// if there are no randomizations finish here, return
 	// the number of partitions found, and leave function
 	if (iNumRandomizations == 0)
+	{
+		FinishPhases (kAnalysis_Partitions);
 		return theNumPartsFound;
+	}
 		
 	// otherwise, if there are randomizations, backup data & go for it!
 	ioPartStream << endl;
 	ioPartStream << "----" << endl;
 	ioPartStream << endl;
 	BackupWorkingData ();
+	ChooseRunSeed ();
 	
+	// Note the progress step is lower for partition searching because
+	// this operation is so slow.
+	StartProgress (kAnalysis_Partitions, 1, iNumRandomizations,
+		iNumRandomizations, kRandomProgressStep / 4);
 	for (int i = 1; i <= (int) iNumRandomizations; i++)
 	{
-		// !! Signal progress of randomizations.
-		// TO DO: This is a bloody awful nasty hack that break the
-		// model-app barrier and will give us grief elsewhere. Find a
-		// better way to do this. Callback?
-		// !! Note the progress step is lower for partition searching because
-		// this operation is so slow.
-		if (((i % (kRandomProgressStep / 4)) == 0) and (i != 0))
-			cout << "Doing randomization " << i << " of "
-				<< iNumRandomizations << " ..." << endl;
-
 		// shuffle data & do calculations
+		// CHANGE: each replicate is shuffled from the original data with
+		// its own seed, as for the other randomization loops.
+		SeedReplicate (i);
 		ShuffleDataset ();		
 		theNumPartsFound += FindParts (ioPartStream, i);		
+		RestoreWorkingData ();
+		
+		if (i == int (mNextProgressRep))
+			ReportProgress (i);
 	}
+	FinishProgress ();
 	
 	if (theNumPartsFound == 0)
 		ioPartStream << "No partitions found" << endl;
 	
 	// restore dataset to original condition
 	RestoreWorkingData ();
+	FinishPhases (kAnalysis_Partitions);
 	return theNumPartsFound;
 }
 
@@ -2593,6 +4582,7 @@ UInt MultiLocusModel::FindPartsLoop
 // TO DO: test new printing code
 UInt MultiLocusModel::FindParts (ofstream& ioPartStream, UInt iRepNum)
 {
+	ScopedPhase thePhase (mProfile, kPhase_Partitions);
 	bool					theDatasetPrinted = false;
 	int					theNumPartsFound = 0;
 	TFrequency<int>	thePartFreq;
@@ -2711,6 +4701,34 @@ bool MultiLocusModel::TestPart
 	
 	UNUSED (iPart2);
 	
+	// CHANGE: the fast engine marks the first partition once & reads each
+	// locus straight down its codes, noting which partitions have each
+	// allele (1 for the first, 2 for the second)
+	if (mEngine == kEngine_Fast)
+	{
+		vector<uchar> theIsInPart1 (GetNumRows(), 0);
+		for (UInt j = 0; j < iPart1.size(); j++)
+			theIsInPart1[iPart1[j]] = 1;
+		
+		for (int i = 0; i < theNumSites; i++)
+		{
+			const UInt*		theCodes = GetLocusCodes (i);
+			vector<uchar>	theParts (mNumLocusAlleles[i], 0);
+			int				theNumSharedAlleles = 0;
+			for (UInt j = 0; j < GetNumRows(); j++)
+			{
+				uchar& theAlleleParts = theParts[theCodes[j]];
+				uchar thePart = theIsInPart1[j] ? 1 : 2;
+				if ((theCodes[j] == 0) or (theAlleleParts & thePart))
+					continue;
+				theAlleleParts |= thePart;
+				if ((theAlleleParts == 3) and (1 < ++theNumSharedAlleles))
+					return false;
+			}
+		}
+		return true;
+	}
+	
 	// test the partition at every site
 	for (int i = 0; i < theNumSites; i++)
 	{
@@ -2721,12 +4739,12 @@ bool MultiLocusModel::TestPart
   		{
 	  		if (is_member (iPart1.begin(), iPart1.end(), j))
 			{
-				theCharCount1.Increment ((*mHaploData)[j][i]);
+				theCharCount1.Increment (mHaploData[j][i]);
 			}
 			else
 			{
 				assert (is_member (iPart2.begin(), iPart2.end(), j));
-				theCharCount2.Increment ((*mHaploData)[j][i]);
+				theCharCount2.Increment (mHaploData[j][i]);
   			}
 		}
 		
@@ -2821,40 +4839,56 @@ OutputPart (ofstream& ioPartStream, vector<int>& iPart)
 double MultiLocusModel::CalcThetaLoop
 (ofstream& ioResults, UInt iNumRandomizations)
 {
-	// Print header
-	InitThetaFile (ioResults);
+	// CHANGE: if resuming from a checkpoint, the header, observed value &
+	// randomizations so far are already in the (rewound) results file.
+	Checkpoint	theCheckpoint;
+	UInt			theFirstRep, theLastRep;
+	int			thePVal = 0;	
+	double		theThetaOrig;
+
+	GetShardRange (iNumRandomizations, theFirstRep, theLastRep);
+	StartPhases ();
+
+	bool theIsResumed = StartCheckpoint (theCheckpoint, kAnalysis_Theta,
+		iNumRandomizations);
+	if (theIsResumed)
+	{
+		theFirstRep = theCheckpoint.mLastReplicate + 1;
+		theThetaOrig = theCheckpoint.mObserved[0];
+		thePVal = theCheckpoint.mExceedances[0];
+		ioResults.setf (ios::showpoint);
+	}
+	else
+	{
+		// Print header
+		InitThetaFile (ioResults);
 
-	// calculate for original set
-	double theThetaOrig;
-	CalcTheta (theThetaOrig);
-	ioResults << "Theta:\t" << theThetaOrig << endl;
-		
-	// if there are randomizations, backup dataset. Else finish here.
-	if (iNumRandomizations == 0)
-		return theThetaOrig;
-		
-	ioResults << endl;
-	ioResults << "Randomizations" << endl;
-	ioResults << "--------------" << endl;
-	ioResults << endl;
+		// calculate for original set
+		CalcTheta (theThetaOrig);
+		ioResults << "Theta:\t" << theThetaOrig << endl;
+			
+		// if there are randomizations, backup dataset. Else finish here.
+		if (iNumRandomizations == 0)
+		{
+			FinishPhases (kAnalysis_Theta);
+			return theThetaOrig;
+		}
+			
+		ioResults << endl;
+		ioResults << "Randomizations" << endl;
+		ioResults << "--------------" << endl;
+		ioResults << endl;
+	}
 	
 	// save state so you can restore later
 	BackupWorkingData ();
 	missing_t theSaveVal = mDoMissingShuffle;
 	mDoMissingShuffle = kMissing_Free;
 	
-	int thePVal = 0;	
-		
-	for (int i = 1; i <= (int) iNumRandomizations; i++)
+	StartProgress (kAnalysis_Theta, theFirstRep, theLastRep, iNumRandomizations,
+		kRandomProgressStep);
+	for (int i = theFirstRep; i <= (int) theLastRep; i++)
 	{
-		// Signal progress of randomizations.
-		// To Do: This is a bloody awful nasty hack that break the
-		// model-app barrier and will give us grief elsewhere. Find a
-		// better way to do this.
-		if (((i % kRandomProgressStep) == 0) and (i != 0))
-			cout << "Doing randomization " << i << " of "
-				<< iNumRandomizations << " ..." << endl;
-
 		// remove (but save) population boundaries
 		Partition thePopBoundaries = mPops;
 		mPops.MergeAll ();
@@ -2862,6 +4896,11 @@ double MultiLocusModel::CalcThetaLoop
 		mLinkages.MergeAll ();
 		
 		// shuffle
+		// CHANGE: each replicate is now shuffled from the original data with
+		// its own seed, rather than reshuffling the previous replicate. A
+		// shuffle of a shuffle is no more random, and this way a replicate
+		// can be recreated without running all those before it.
+		SeedReplicate (i);
 		ShuffleDataset ();
 		
 		// restore population boundaries
@@ -2878,23 +4917,51 @@ double MultiLocusModel::CalcThetaLoop
 		// do P value calculation
 		if (theThetaOrig <= theThetaRand)
 			thePVal++;
-			
+		
+		RestoreWorkingData ();
+		
+		// save progress every so often, but not at the very end
+		if (mCheckpointStep and ((i % mCheckpointStep) == 0)
+			and (i < (int) theLastRep))
+		{
+			theCheckpoint.mObserved.assign (1, theThetaOrig);
+			theCheckpoint.mExceedances.assign (1, thePVal);
+			ioResults.flush ();
+			theCheckpoint.mOffsets[kOutput_Theta] = long (ioResults.tellp());
+			SaveCheckpoint (theCheckpoint, i);
+		}
+		
+		if (i == int (mNextProgressRep))
+			ReportProgress (i);
 	}
+	FinishProgress ();
 
 	// restore priot state
 	RestoreWorkingData ();
 	mDoMissingShuffle = theSaveVal;
 	
-	// calculate & print overall P value.
-	ioResults << endl;
-	ioResults << "P value:\t";
-	if (thePVal == 0)
-		ioResults << "< " << (1.0 / (double) iNumRandomizations);
+	// calculate & print overall P value, or just the count for a shard
+	if (IsSharded())
+	{
+		OutputShardCounts (ioResults, iNumRandomizations,
+			vector<UInt> (1, thePVal));
+	}
 	else
-		ioResults << double ((double) thePVal / (double) iNumRandomizations);
-	ioResults << endl;
+	{
+		ioResults << endl;
+		ioResults << "P value:\t";
+		if (thePVal == 0)
+			ioResults << "< " << (1.0 / (double) iNumRandomizations);
+		else
+			ioResults << double ((double) thePVal / (double) iNumRandomizations);
+		ioResults << endl;
+	}
+	
+	if (mCheckpointStep or theIsResumed)
+		Checkpoint::Remove (mCheckpointPath.c_str());
 	
 	// return original result
+	FinishPhases (kAnalysis_Theta);
 	return theThetaOrig;
 }
 
@@ -2908,10 +4975,21 @@ double MultiLocusModel::CalcThetaLoop
 // necessarily informative.
 void MultiLocusModel::CalcTheta (double& oTheta)
 {
+	ScopedPhase thePhase (mProfile, kPhase_Theta);
 	int   	theNumPops = mPops.GetNumParts ();
 	int		theNumSites = GetNumCols ();
 	int		theNumSitesSampled = 0;
 	double	theSum_Q2 = 0.0, theSum_Q3 = 0.0;
+	
+	// CHANGE: the fast engine counts alleles from the locus codes
+	if (mEngine == kEngine_Fast)
+	{
+		vector<int> thePops (theNumPops);
+		for (int j = 0; j < theNumPops; j++)
+			thePops[j] = j;
+		CalcThetaFromCodes (thePops, oTheta);
+		return;
+	}
 
 	// for every site ...
 	for (int i = 0; i < theNumSites; i++)
@@ -2932,12 +5010,12 @@ void MultiLocusModel::CalcTheta (double& oTheta)
 			{
 		  		if (GetPloidy() == kPloidy_Haploid)
 		  		{
-		  			theAlleleFreqs[j].Increment ((*mHaploData)[k][i]);
+		  			theAlleleFreqs[j].Increment (mHaploData[k][i]);
 				}
 				else
 				{
-		  			theAlleleFreqs[j].Increment ((*mDiploData)[k][i].alleleA);
-		  			theAlleleFreqs[j].Increment ((*mDiploData)[k][i].alleleB);
+		  			theAlleleFreqs[j].Increment (mDiploData[k][i].alleleA);
+		  			theAlleleFreqs[j].Increment (mDiploData[k][i].alleleB);
 				}
 			}
 		}
@@ -3066,42 +5144,58 @@ void MultiLocusModel::CalcTheta (double& oTheta)
 double MultiLocusModel::CalcThetaChoiceLoop
 (ofstream& ioResults, Combination& iSelectedPops, UInt iNumRandomizations)
 {
-	// Print header
-	InitThetaFile (ioResults);
+	// CHANGE: resuming from a checkpoint, as for CalcThetaLoop().
+	Checkpoint	theCheckpoint;
+	UInt			theFirstRep, theLastRep;
+	int			thePVal = 0;	
+	double		theThetaOrig;
+
+	GetShardRange (iNumRandomizations, theFirstRep, theLastRep);
+	StartPhases ();
+
 	iSelectedPops.Sort();
-	ioResults << "Populations selected for analysis:";
-	for (int i = 0; i < (int) iSelectedPops.Size(); i++)
-		ioResults << " " << iSelectedPops[i] + 1;
-	ioResults << endl << endl;
-	ioResults << "---" << endl;
-	ioResults << endl;
-
-	// calculate for original set
-	double theThetaOrig;
-	CalcThetaChoice (theThetaOrig, iSelectedPops);
-	ioResults << "Theta:\t" << theThetaOrig << endl;
-		
-	// if there are randomizations, backup dataset. Else finish here.
-	if (iNumRandomizations == 0)
-		return theThetaOrig;
-		
-	ioResults << endl;
-	ioResults << "Randomizations" << endl;
-	ioResults << "--------------" << endl;
-	ioResults << endl;
+	bool theIsResumed = StartCheckpoint (theCheckpoint, kAnalysis_ThetaChoice,
+		iNumRandomizations);
+	if (theIsResumed)
+	{
+		theFirstRep = theCheckpoint.mLastReplicate + 1;
+		theThetaOrig = theCheckpoint.mObserved[0];
+		thePVal = theCheckpoint.mExceedances[0];
+		ioResults.setf (ios::showpoint);
+	}
+	else
+	{
+		// Print header
+		InitThetaFile (ioResults);
+		ioResults << "Populations selected for analysis:";
+		for (int i = 0; i < (int) iSelectedPops.Size(); i++)
+			ioResults << " " << iSelectedPops[i] + 1;
+		ioResults << endl << endl;
+		ioResults << "---" << endl;
+		ioResults << endl;
+
+		// calculate for original set
+		CalcThetaChoice (theThetaOrig, iSelectedPops);
+		ioResults << "Theta:\t" << theThetaOrig << endl;
+			
+		// if there are randomizations, backup dataset. Else finish here.
+		if (iNumRandomizations == 0)
+		{
+			FinishPhases (kAnalysis_ThetaChoice);
+			return theThetaOrig;
+		}
+			
+		ioResults << endl;
+		ioResults << "Randomizations" << endl;
+		ioResults << "--------------" << endl;
+		ioResults << endl;
+	}
 	BackupWorkingData ();
-	int thePVal = 0;	
 		
-	for (int i = 1; i <= (int) iNumRandomizations; i++)
+	StartProgress (kAnalysis_ThetaChoice, theFirstRep, theLastRep,
+		iNumRandomizations, kRandomProgressStep);
+	for (int i = theFirstRep; i <= (int) theLastRep; i++)
 	{
-		// Signal progress of randomizations.
-		// To Do: This is a bloody awful nasty hack that break the
-		// model-app barrier and will give us grief elsewhere. Find a
-		// better way to do this.
-		if (((i % kRandomProgressStep) == 0) and (i != 0))
-			cout << "Doing randomization " << i << " of "
-				<< iNumRandomizations << " ..." << endl;
-
 		// remove (but save) population boundaries
 		//Partition thePopBoundaries = mPops;
 		//mPops.MergeAll ();
@@ -3109,6 +5203,9 @@ double MultiLocusModel::CalcThetaChoiceLoop
 		mLinkages.MergeAll ();
 		
 		// shuffle
+		// CHANGE: from the original data with a per-replicate seed, as
+		// for CalcThetaLoop().
+		SeedReplicate (i);
 		ShufflePops (iSelectedPops);
 		
 		// restore population boundaries
@@ -3125,22 +5222,50 @@ double MultiLocusModel::CalcThetaChoiceLoop
 		// do P value calculation
 		if (theThetaOrig <= theThetaRand)
 			thePVal++;
-			
+		
+		RestoreWorkingData ();
+		
+		// save progress every so often, but not at the very end
+		if (mCheckpointStep and ((i % mCheckpointStep) == 0)
+			and (i < (int) theLastRep))
+		{
+			theCheckpoint.mObserved.assign (1, theThetaOrig);
+			theCheckpoint.mExceedances.assign (1, thePVal);
+			ioResults.flush ();
+			theCheckpoint.mOffsets[kOutput_Theta] = long (ioResults.tellp());
+			SaveCheckpoint (theCheckpoint, i);
+		}
+		
+		if (i == int (mNextProgressRep))
+			ReportProgress (i);
 	}
+	FinishProgress ();
 
 	// restore dataset
 	RestoreWorkingData ();
 	
-	// calculate & print overall P value.
-	ioResults << endl;
-	ioResults << "P value:\t";
-	if (thePVal == 0)
-		ioResults << "< " << (1.0 / (double) iNumRandomizations);
+	// calculate & print overall P value, or just the count for a shard
+	if (IsSharded())
+	{
+		OutputShardCounts (ioResults, iNumRandomizations,
+			vector<UInt> (1, thePVal));
+	}
 	else
-		ioResults << double ((double) thePVal / (double) iNumRandomizations);
-	ioResults << endl;
+	{
+		ioResults << endl;
+		ioResults << "P value:\t";
+		if (thePVal == 0)
+			ioResults << "< " << (1.0 / (double) iNumRandomizations);
+		else
+			ioResults << double ((double) thePVal / (double) iNumRandomizations);
+		ioResults << endl;
+	}
+	
+	if (mCheckpointStep or theIsResumed)
+		Checkpoint::Remove (mCheckpointPath.c_str());
 	
 	// return original result
+	FinishPhases (kAnalysis_ThetaChoice);
 	return theThetaOrig;
 }
 
@@ -3152,6 +5277,7 @@ double MultiLocusModel::CalcThetaChoiceLoop
 // linkage groups are preserved.
 void MultiLocusModel::ShufflePops (Combination& iSelectedPops)
 {
+	ScopedPhase thePhase (mProfile, kPhase_Shuffle);
 	// collect vector of population indexes
 	vector<int> theSelectedIsos;
 	// step through the vector of populations and collate them
@@ -3199,12 +5325,23 @@ void MultiLocusModel::ShufflePops (Combination& iSelectedPops)
 void MultiLocusModel::CalcThetaChoice
 (double& oTheta, Combination& iSelectedPops)
 {
+	ScopedPhase thePhase (mProfile, kPhase_Theta);
 	iSelectedPops.Sort();
 	int		theNumSelectedPops = iSelectedPops.Size ();
 	int		theNumTotalPops = mPops.GetNumParts ();
 	int		theNumSites = GetNumCols ();
 	int		theNumSitesSampled = 0;
 	double	theSum_Q2 = 0.0, theSum_Q3 = 0.0;
+	
+	// CHANGE: the fast engine counts alleles from the locus codes
+	if (mEngine == kEngine_Fast)
+	{
+		vector<int> thePops (theNumSelectedPops);
+		for (int j = 0; j < theNumSelectedPops; j++)
+			thePops[j] = iSelectedPops[j];
+		CalcThetaFromCodes (thePops, oTheta);
+		return;
+	}
 
 	// for every site ...
 	for (int i = 0; i < theNumSites; i++)
@@ -3225,12 +5362,12 @@ void MultiLocusModel::CalcThetaChoice
 			{
 		  		if (GetPloidy() == kPloidy_Haploid)
 		  		{
-		  			theAlleleFreqs[j].Increment ((*mHaploData)[k][i]);
+		  			theAlleleFreqs[j].Increment (mHaploData[k][i]);
 				}
 				else
 				{
-		  			theAlleleFreqs[j].Increment ((*mDiploData)[k][i].alleleA);
-		  			theAlleleFreqs[j].Increment ((*mDiploData)[k][i].alleleB);
+		  			theAlleleFreqs[j].Increment (mDiploData[k][i].alleleA);
+		  			theAlleleFreqs[j].Increment (mDiploData[k][i].alleleB);
 				}
 			}
 		}
@@ -3354,6 +5491,110 @@ void MultiLocusModel::CalcThetaChoice
 }
 
 
+// CALC THETA FROM CODES
+// As CalcTheta(), over the given populations, with the alleles of each
+// population counted by number from the locus codes rather than by name.
+void MultiLocusModel::CalcThetaFromCodes (const vector<int>& iPops,
+	double& oTheta)
+{
+	int		theNumPops = iPops.size ();
+	int		theNumSites = GetNumCols ();
+	int		theNumSitesSampled = 0;
+	double	theSum_Q2 = 0.0, theSum_Q3 = 0.0;
+	bool		theIsDiploid = (GetPloidy() == kPloidy_Diploid);
+	
+	for (int i = 0; i < theNumSites; i++)
+	{
+		const UInt*				theCodes = GetLocusCodes (i);
+		const vector<UInt>&	theClassAlleles = mLocusClassAlleles[i];
+		UInt						theNumAlleles = mNumLocusAlleles[i];
+		
+		// the frequency of each allele in each population, missing or not
+		vector<long> theFreqs (theNumPops * theNumAlleles, 0);
+		for (int j = 0; j < theNumPops; j++)
+		{
+			int	theStart, theEnd;
+			mPops.GetBounds (iPops[j], theStart, theEnd);
+			long*	thePopFreqs = &theFreqs[j * theNumAlleles];
+			for (int k = theStart; k <= theEnd; k++)
+			{
+				thePopFreqs[theClassAlleles[2 * theCodes[k]]]++;
+				if (theIsDiploid)
+					thePopFreqs[theClassAlleles[(2 * theCodes[k]) + 1]]++;
+			}
+		}
+		
+		// the sums over each population & each allele, ignoring missing
+		vector<long>	theSumArray (theNumPops, 0);
+		vector<long>	theAlleleSums (theNumAlleles, 0);
+		int				theNumAllelesSeen = 0;
+		for (int j = 0; j < theNumPops; j++)
+		{
+			for (UInt a = 1; a < theNumAlleles; a++)
+			{
+				theSumArray[j] += theFreqs[(j * theNumAlleles) + a];
+				theAlleleSums[a] += theFreqs[(j * theNumAlleles) + a];
+			}
+		}
+		for (UInt a = 1; a < theNumAlleles; a++)
+		{
+			if (0 < theAlleleSums[a])
+				theNumAllelesSeen++;
+		}
+		
+		// the rest is exactly as in CalcTheta()
+		if (2 <= theNumAllelesSeen)
+		{
+			theNumSitesSampled++;
+			double	theSumFreq = 0.0, theSumSqFreq = 0.0;
+			double	the_NBar, the_Nc, the_X = 0.0, the_Y = 0.0, the_Q2, the_Q3;
+			
+			for (int k = 0; k < theNumPops; k++)
+			{
+				theSumFreq += theSumArray[k];
+				theSumSqFreq += (theSumArray[k] * theSumArray[k]);
+			}
+			
+			for (UInt a = 1; a < theNumAlleles; a++)
+			{
+				if (theAlleleSums[a] == 0)
+					continue;
+				the_Y += theAlleleSums[a] * theAlleleSums[a];
+				
+				double theAlleleSum = 0;
+				for (int m = 0; m < theNumPops; m++)
+				{
+					double thePopVal = theFreqs[(m * theNumAlleles) + a];
+					if (thePopVal != 0)
+						theAlleleSum += double ((thePopVal * thePopVal))
+							/ double (theSumArray[m]);
+				}
+				the_X += theAlleleSum;
+			}
+			
+			the_NBar = theSumFreq / double (theNumPops);
+			the_Nc = (1.0 / (double (theNumPops) - 1.0)) *
+				(theSumFreq - (theSumSqFreq / theSumFreq));
+			the_Q2 = (the_X - theNumPops) / (theNumPops * (the_NBar - 1.0));
+			the_Q3 = (1.0 / (theNumPops * (theNumPops - 1.0) * the_NBar
+				* the_Nc)) * (the_Y - ((the_NBar * (the_Nc - 1.0)
+				/ (the_NBar - 1.0)) * the_X));
+			the_Q3 += ((the_NBar - the_Nc) / (the_Nc * (the_NBar - 1.0))) *
+				(1.0 - (the_X / (theNumPops - 1.0)));
+			
+			theSum_Q2 += the_Q2;
+			theSum_Q3 += the_Q3;
+		}
+	}
+	
+	// need to have been able to sample at least one site
+	if (0 < theNumSitesSampled)
+		oTheta = (theSum_Q2 - theSum_Q3) / (theNumSitesSampled - theSum_Q3);
+	else
+		throw Error("Need to be able to sample at least 1 polymorphic locus");
+}
+
+
 // *** PRIMITIVES ********************************************************/
 #pragma mark --
 
@@ -3472,41 +5713,24 @@ StrictDistance (UInt iFromIso, UInt iToIso, UInt iTargetLoci)
 {
 	if (GetPloidy() == kPloidy_Haploid)
 	{
-		return StrictDistance ((*mHaploData)[iFromIso][iTargetLoci],
-			(*mHaploData)[iToIso][iTargetLoci]);
+		return StrictDistance (mHaploData[iFromIso][iTargetLoci],
+			mHaploData[iToIso][iTargetLoci]);
 	}
 	else
 	{
-		return StrictDistance ((*mDiploData)[iFromIso][iTargetLoci],
-			(*mDiploData)[iToIso][iTargetLoci]);
+		return StrictDistance (mDiploData[iFromIso][iTargetLoci],
+			mDiploData[iToIso][iTargetLoci]);
 	}
 }
 
 
 // IS MISSING
 // Is the allele (or allelepair) at this location missing any data?
+// CHANGE: read from the cells noted as missing, not the alleles.
 bool MultiLocusModel::IsMissing (UInt iRowIndex, UInt iColIndex)
 {
-	if (GetPloidy() == kPloidy_Haploid)
-	{
-		//if ((*mHaploData)[iRowIndex][iColIndex] == kSymbol_Unknown)
-		//	return true;
-		if (IsMissing((*mHaploData)[iRowIndex][iColIndex]))
-			return true;
-	}
-	else
-	{
-//		if ((*mDiploData)[iRowIndex][iColIndex].alleleA == kSymbol_Unknown)
-//			return true;
-//		if ((*mDiploData)[iRowIndex][iColIndex].alleleB == kSymbol_Unknown)
-//			return true;
-		if (IsMissing((*mDiploData)[iRowIndex][iColIndex].alleleA))
-			return true;
-		if (IsMissing((*mDiploData)[iRowIndex][iColIndex].alleleB))
-			return true;
-	}
-	
-	return false;
+	assert ((iRowIndex < GetNumRows()) and (iColIndex < GetNumCols()));
+	return mIsCellMissing[(iColIndex * GetNumRows()) + iRowIndex];
 }
 
 bool MultiLocusModel::IsMissing (const char* ikSymbol)
@@ -3529,8 +5753,8 @@ bool MultiLocusModel::IsHomozygous (UInt iRowIndex, UInt iColIndex)
 {
 	assert (GetPloidy() != kPloidy_Haploid);
 
-	if ((*mDiploData)[iRowIndex][iColIndex].alleleA ==
-		(*mDiploData)[iRowIndex][iColIndex].alleleB)
+	if (mDiploData[iRowIndex][iColIndex].alleleA ==
+		mDiploData[iRowIndex][iColIndex].alleleB)
 		return true;
 	else
 		return false;
@@ -3539,14 +5763,11 @@ bool MultiLocusModel::IsHomozygous (UInt iRowIndex, UInt iColIndex)
 
 // IS COL MISSING
 // Does this column contain missing data?
+// CHANGE: from the count of missing cells, kept up to date.
 bool MultiLocusModel::IsColMissing (UInt iColIndex)
 {
-	for (int i = 0; i < (int) GetNumRows(); i++)
-	{
-		if (IsMissing (i,iColIndex))
-			return true;
-	}
-	return false;
+	assert (iColIndex < GetNumCols());
+	return (0 < mNumLocusMissing[iColIndex]);
 }
 
 
@@ -3564,14 +5785,11 @@ bool MultiLocusModel::IsColMissing ()
 
 // IS ROW MISSING
 // Does this row contain missing data?
+// CHANGE: as for columns.
 bool MultiLocusModel::IsRowMissing (UInt iRowIndex)
 {
-	for (int i = 0; i < (int) GetNumCols(); i++)
-	{
-		if (IsMissing (iRowIndex, i))
-			return true;
-	}
-	return false;
+	assert (iRowIndex < GetNumRows());
+	return (0 < mNumIsoMissing[iRowIndex]);
 }
 
 
@@ -24,6 +24,9 @@ About:
 #include "Partition.h"
 #include "RandomService.h"
 #include "StreamScanner.h"
+#include "ProgressObserver.h"
+#include "PhaseTimer.h"
+#include "FlatMatrix.h"
 //#include "Combination.h"
 
 #include <vector>
@@ -32,6 +35,7 @@ About:
 #include <string>
 #include <utility>
 #include <map>
+#include <chrono>
 
 using std::vector;
 using std::ifstream;
@@ -44,6 +48,9 @@ using std::map;
 using namespace sbl;
 
 class Combination;
+class Checkpoint;
+class BootstrapEngine;
+class PairDistArray;
 
 
 // *** CONSTANTS & DEFINES
@@ -63,6 +70,11 @@ enum distance_t			// aloow ambiguity in distances or not?
 	kDistance_Relaxed
 };
 
+// names of the analyses that can be checkpointed, see ReadCheckpoint()
+extern const char* kAnalysis_Diversity;
+extern const char* kAnalysis_Theta;
+extern const char* kAnalysis_ThetaChoice;
+
 // types for allele states, to divorce interface from implementation
 
 typedef string tAllele;								// haploid							
@@ -71,7 +83,8 @@ struct tAllelePair									// diploid
 {
 	string alleleA;
 	string alleleB;
-	char transNumDTypes;
+	UInt transNumDTypes;	// the translation for PAUP, see InitDTypeTranslations()
+	UInt dtypeId;			// the diplotype at this locus, see InitLocusDTypes()
 };
 
 // types for linkage groups
@@ -86,6 +99,45 @@ enum missing_t
 	kMissing_Free
 };
 
+// which implementation of the statistics kernels to use, the reference
+// being kept to check any faster ones against
+enum engine_t
+{
+	kEngine_Reference,
+	kEngine_Fast
+};
+
+// the variance of distances estimated from a sample of pairs of isolates,
+// see EstimateVarDist()
+struct PairSample
+{
+	UInt		mNumPairs;
+	double	mVarDist;			// over all loci
+	double	mVarDistError;		// the standard error of that
+};
+
+// the statistics of a dataset weighted by isolate, found for each
+// bootstrap replicate (see BootstrapEngine.h) & for the distinct genotypes
+// of the data (see CalcGenotypeStats())
+struct BootstrapStats
+{
+	int				mNumDiff;
+	int				mMaxFreq;
+	double			mDiversity;
+	double			mVarDistObs;	// of the distances over all loci
+	vector<double>	mVarDist;		// expected, for each locus
+};
+
+// the statistics found for each bootstrap replicate, see CalcBootstrapStats()
+enum bootstat_t
+{
+	kBootStat_NumDiff = 0,
+	kBootStat_Diversity,
+	kBootStat_IndexAssoc,
+	kBootStat_RBarD,
+	kBootStat_Size
+};
+
 
 // *** CLASS DECLARATION *************************************************/
 
@@ -128,9 +180,6 @@ public:
 	bool			IsRowMissing			(UInt iRowIndex);
 	bool			IsRowMissing			();
 
-	void			DeleteCol				(UInt iColIndex);
-	void			DeleteRow				(UInt iRowIndex);
-
 	void			PrintDataSet			(ostream& ioOutStream);
 	
 	// Calculations
@@ -139,6 +188,10 @@ public:
 	void	InitThetaFile				(ofstream& iThetaStream);
 	void	InitPairsFile 				(ofstream& iPairsStream);
 	void	InitPlotFile				(ofstream& ioPlotStream);
+	void	InitWindowsFile			(ofstream& ioWindowStream, UInt iWidth,
+												UInt iStep);
+	void	InitJackknifeFile			(ofstream& ioJackStream);
+	void	InitBootstrapFile			(ofstream& ioBootStream);
 	void	InitFileWithSettings		(ofstream& iFileStream);
 	void	PrintSettings				(ostream& oSettingsStream);
 
@@ -146,6 +199,11 @@ public:
 	void	CalcDiversity				(bool iDoPairwiseStats, int iNumRandomizations,
 											bool iDoPaupOutput, ofstream& iStatsStream,
 											ofstream& iPairsStream, ofstream& iPaupStream );
+	void	CalcWindows					(UInt iWidth, UInt iStep, int iNumRandomizations,
+												ofstream& ioWindowStream);
+	void	CalcJackknife				(ofstream& ioJackStream);
+	void	CalcBootstrap				(UInt iNumReplicates, double iConfidence,
+												ofstream& ioBootStream);
 	void	OutputAsPaup				(ofstream& iPaupStream);
 	
 	void	PrepRBarSCalc				();
@@ -164,9 +222,20 @@ public:
 	double	CalcThetaLoop 			(ofstream& ioResults, UInt iNumRandomizations);
 	double	CalcThetaChoiceLoop	(ofstream& ioResults, Combination& theSelectedPops,
 												UInt iNumRandomizations);
+
+	// kernels of the loops, public so that engines can be checked
+	UInt	FindParts					(ofstream& ioPartStream, UInt iRepNum);
+	void	CalcTheta					(double& oTheta);
+	void	SeedReplicate				(UInt iRepNum);
+	void	CalcWindowStats			(UInt iWidth, UInt iStep,
+												vector<double>& oIndexAssoc,
+												vector<double>& oRBarD);
+	void	CalcJackknifeStats		(vector<double>& oIndexAssoc,
+												vector<double>& oRBarD);
+	void	CalcBootstrapStats		(UInt iNumReplicates, MATRIX(double)& oStats);
 	
 	// dimensions of data
-	UInt				mNumPairsIsolates;	// calculated
+	ulong				mNumPairsIsolates;	// calculated, in 64 bits for big data
 	UInt				mNumPairsSites;		// calculated
 	
 	bool				mIsDataRankable;
@@ -175,10 +244,18 @@ public:
 	vector<double>	mVarDist;
 	double			mSumVarDist;
 	double			mMaxSumCov1;
+	double			mIndexAssocError;		// of the last estimate, 0 if exact
+	double			mRBarDError;
 	double			mSumVar2, mMaxSumCov2;
 
 	vector<tAllelePair>		mDiploTrans;	// array of unique dtypes
-	vector< vector<int> >	mStepMatrix;	// distances between diplotypes
+	vector<uchar>				mStepMatrix;	// distances between diplotypes, flattened
+	
+	// for each locus, the number of diplotypes & the distances between
+	// them, each as a flattened square, looked up by the fast engine
+	vector<UInt>					mNumLocusDTypes;
+	vector< vector<uchar> >		mLocusDTypeDists;
+	vector< vector<uchar> >		mLocusDTypeStrictDists;
 		
 	// for partitioning of loci & isolates	
 	Partition					mLinkages;
@@ -189,40 +266,146 @@ public:
 	bool							mExcludeIso;
 	missing_t					mDoMissingShuffle;
 	
+	// for checkpointing & resuming long randomizations
+	UInt							mCheckpointStep;		// replicates between saves, 0 for never
+	string						mCheckpointPath;
+	bool							mResumeFromCheckpoint;
+	void	ReadCheckpoint		(Checkpoint& oCheckpoint, const char* iAnalysis,
+									UInt iNumRandomizations, bool iHasPairStats = false);
+	
+	// for splitting randomizations across several processes
+	UInt							mShardIndex;			// counting from 0
+	UInt							mNumShards;				// 1 for an unsplit run
+	
+	// for choosing the implementation of the statistics
+	engine_t						mEngine;
+	
+	// for sharing bootstrap replicates between threads, 1 for none
+	UInt							mNumThreads;
+	
+	// for estimating the variance of distances from a sample of pairs of
+	// isolates, the standard error wanted as a fraction of the estimate, 0
+	// for using every pair
+	double						mPairSampleError;
+	
+	long			GetRunSeed				();
+	void			SetRunSeed				(long iSeed);
+	bool			IsSharded				();
+	
+	// reporting progress of randomizations
+	void			AddObserver				(ProgressObserver* iObserver);
+	void			RemoveObserver			(ProgressObserver* iObserver);
+	const PhaseProfile&	GetProfile	();
+	
 private:
 	// internals
 	ploidy_t 					mPloidy;
 	
-	// the various representations of the data
-	MATRIX(tAllele)*			mHaploData;				// the current data
-	MATRIX(tAllelePair)*		mDiploData;
-	
-	MATRIX(tAllele)*			mBackupHaploData;		// the saved manipulated data
-	MATRIX(tAllelePair)*		mBackupDiploData;
+	// the various representations of the data, only those of the ploidy
+	// read being filled
+	FlatMatrix<tAllele>			mHaploData;				// the current data
+	FlatMatrix<tAllelePair>		mDiploData;
 
-	MATRIX(tAllele)*			mOriginalHaploData;	// the original data
-	MATRIX(tAllelePair)*		mOriginalDiploData;
+	FlatMatrix<tAllele>			mBackupHaploData;		// the saved manipulated data
+	FlatMatrix<tAllelePair>		mBackupDiploData;
+	
+	FlatMatrix<tAllele>			mOriginalHaploData;	// the original data
+	FlatMatrix<tAllelePair>		mOriginalDiploData;
+	
+	// the isolates & loci of the original data that are in the current
+	// data, which is drawn from the original by these (see ApplyInclusion())
+	vector<bool>				mIsIsoIncluded;
+	vector<bool>				mIsLocusIncluded;
+	
+	// the swaps made since the data was saved or restored, as triples of a
+	// locus & two isolates, unless there were too many to be worth undoing
+	// (see RestoreWorkingData())
+	bool							mHasBackup;
+	bool							mIsJournalFull;
+	vector<UInt>				mSwapJournal;
+	UInt							mJournalLimit;
+	
+	// the ranks of the alleles for rBarS, if the data is rankable, as a
+	// flattened matrix of isolates by loci. Kept in step with the data.
+	vector<int>					mRanks;
+	vector<long>				mIsoRankSums;			// over each isolate
+	vector<int>					mBackupRanks;
+	vector<long>				mBackupIsoRankSums;
+	
+	// the data coded locus by locus, for kernels that scan a locus at a
+	// time: the class of each cell as a flattened matrix of loci by
+	// isolates, kept in step with the data. The classes are the diplotypes
+	// of InitLocusDTypes() or the haploid alleles. Each is a pair of
+	// alleles, numbered from 1 at each locus with 0 for missing.
+	vector<UInt>				mLocusCodes;
+	vector<UInt>				mBackupLocusCodes;
+	vector< vector<UInt> >	mLocusClassAlleles;	// two for each class
+	vector<UInt>				mNumLocusAlleles;		// counting missing
+	
+	// which cells are missing data (either allele, for diploids), in the
+	// order of the locus codes & kept in step with them, & how many of each
+	// isolate & locus are
+	vector<bool>				mIsCellMissing;
+	vector<UInt>				mNumIsoMissing;
+	vector<UInt>				mNumLocusMissing;
+	vector<bool>				mBackupIsCellMissing;
+	vector<UInt>				mBackupNumIsoMissing;
+	
+	// the statistics of the distinct genotypes of the data as it is, found
+	// once & forgotten whenever the data changes (see CalcGenotypeStats())
+	bool							mIsGtypeStatsKnown;
+	bool							mHasGtypeStats;		// if isolates share genotypes
+	BootstrapStats				mGtypeStats;
 	
 	RandomService				mRng;
+	long							mRunSeed;				// replicates are seeded from this
+	bool							mRunSeedGiven;			// set by the caller, not chosen
 	
 	string						mDataName;
+	
+	// for progress reports
+	vector<ProgressObserver*>	mObservers;
+	ProgressReport				mProgress;
+	std::chrono::steady_clock::time_point	mProgressStartTime;
+	UInt							mProgressStep;
+	UInt							mNextProgressRep;		// when the next report is due
+	PhaseProfile				mProfile;				// where the time goes
+
+	// internals for checkpointing & sharding of randomizations
+	void	ChooseRunSeed		();
+	bool	StartCheckpoint	(Checkpoint& oCheckpoint, const char* iAnalysis,
+									UInt iNumRandomizations, bool iHasPairStats = false);
+	void	SaveCheckpoint		(Checkpoint& ioCheckpoint, UInt iRepNum);
+	void	GetShardRange		(UInt iNumRandomizations, UInt& oFirstRep,
+									UInt& oLastRep);
+	void	OutputShardCounts	(ofstream& ioOutStream, UInt iNumRandomizations,
+									const vector<UInt>& iExceedances);
+
+	// internals for progress reports
+	void	StartProgress		(const char* iAnalysis, UInt iFirstRep, UInt iLastRep,
+									UInt iNumRandomizations, UInt iStep);
+	void	ReportProgress		(UInt iRepNum);
+	void	FinishProgress		();
+	void	UpdateProgress		(UInt iRepNum);
+	void	StartPhases			();
+	void	FinishPhases		(const char* iAnalysis);
 
 	// internals for searching of partition
-	UInt	FindParts		(ofstream& ioPartStream, UInt iRepNum);
 	void	OutputPart		(ofstream& ioPartStream, vector<int>& iPart);
 	bool	TestPart			(Combination& iPart1, Combination& iPart2);
 	bool	TestPart			(vector<int>& iPart1, vector<int>& iPart2);
 	
 	// internals for calculating theta
-	void		CalcTheta			(double& oTheta);
 	void		ShufflePops			(Combination& iSelectedPops);
 	void		CalcThetaChoice	(double& oTheta, Combination& iSelectedPops);
+	void		CalcThetaFromCodes	(const vector<int>& iPops, double& oTheta);
 
 	// internals for shuffling of data
 	void	ShufflePop 		(int iFrom, int iTo);
 	void	ShuffleBlock	(int iFromAllele, int iToAllele, int iFromPop,
 								int iToPop);
 	void	SwapAllele		(int iAllelePosn, int iFromPop, int iToPop);
+	void	ExchangeAlleles	(UInt iLocus, UInt iIso1, UInt iIso2);
 	
 	// internals for reading in data from stream
 	void	ParseHaploidInput 	(StreamScanner& iScanner, UInt iNumCols);
@@ -237,17 +420,41 @@ private:
 	UInt	StrictDistance 	(UInt iFromRowIndex, UInt iToRowIndex);
 	UInt	StrictDistance 	(UInt iFromIso, UInt iToIso, UInt iTargetLoci);
 	
-	char	GenerateDTypeSymbol 		(UInt iDipTypeIndex);
+	string	GenerateDTypeSymbol 	(UInt iDipTypeIndex);
+	bool	AreDTypesTokens			();
 	void	InitDTypeTranslations	();
+	void	InitLocusDTypes			();
+	void	InitLocusCodes				();
+	void	InitMissing					();
+	void	ApplyInclusion				();
+	const UInt*	GetLocusCodes		(UInt iLocus);
+	UInt	GetNumLocusClasses		(UInt iLocus);
+	UInt	NumberLocusClasses		(UInt iLocus, const vector<UInt>& iRows,
+											vector<UInt>& oClasses,
+											vector<uchar>& oDists);
+	void	InitBootstrapEngine		(BootstrapEngine& ioEngine,
+											const vector<UInt>& iRows);
+	bool	FindGenotypes				(vector<UInt>& oRows, vector<UInt>& oWeights);
+	bool	CalcGenotypeStats			(BootstrapStats& oStats);
+	bool	EstimateVarDist			(PairSample& oSample);
 	
 	void		CalcIsoDistArray		(vector<int>& oDistArray,
 											distance_t iIsDistStrict = kDistance_Relaxed);
+	void		CalcPairDists			(PairDistArray& oDists,
+											distance_t iIsDistStrict = kDistance_Relaxed);
+	template <typename REDUCER>
+	void		StreamPairDists		(const vector<UInt>& iLoci,
+											REDUCER& ioReducer);
+	UInt		GetMaxLocusDist		();
+	void		AddLocusToDistArray	(UInt iLocus, int iWeight,
+											PairDistArray& ioDists);
 	UInt		CountGtypesFromDist	(vector<int>& oDistArray);
 	double	CalcDivFromDist 		(vector<int>& oDistArray);
 	void		CountFreqsFromDist	(vector<int>& oDistArray, vector<int>& oGtypeFreq);
 
 	bool	IsAlleleRankable		(string& iAlleleStr);
 	bool	IsHomozygous			(UInt iRowIndex, UInt iColIndex);
+	void	InitRanks				();
 };
 
 
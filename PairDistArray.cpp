@@ -0,0 +1,85 @@
+/**************************************************************************
+PairDistArray.cpp - the distances between pairs of isolates, held narrow
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. Sums are taken as doubles or longs whatever the width.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "PairDistArray.h"
+
+#include <climits>
+
+
+// *** KERNELS ***********************************************************/
+
+template <typename DIST>
+static void DistMoments (const vector<DIST>& iDists, double& oSumDist,
+	double& oSumDistSq)
+{
+	oSumDist = oSumDistSq = 0.0;
+	for (ulong i = 0; i < iDists.size(); i++)
+	{
+		double theDist = iDists[i];
+		oSumDist += theDist;
+		oSumDistSq += theDist * theDist;
+	}
+}
+
+
+// *** SERVICES **********************************************************/
+
+// RESET
+// Every distance to 0, in the narrowest width that holds the largest.
+void PairDistArray::Reset (ulong iNumPairs, UInt iMaxDist)
+{
+	mNumPairs = iNumPairs;
+	mBytes.clear ();
+	mShorts.clear ();
+	mInts.clear ();
+
+	if (iMaxDist <= UCHAR_MAX)
+	{
+		mWidth = kDistWidth_Byte;
+		mBytes.assign (iNumPairs, 0);
+	}
+	else if (iMaxDist <= USHRT_MAX)
+	{
+		mWidth = kDistWidth_Short;
+		mShorts.assign (iNumPairs, 0);
+	}
+	else
+	{
+		mWidth = kDistWidth_Int;
+		mInts.assign (iNumPairs, 0);
+	}
+}
+
+
+// CALCULATE MOMENTS
+// The sum of the distances & of their squares.
+void PairDistArray::CalcMoments (double& oSumDist, double& oSumDistSq) const
+{
+	switch (mWidth)
+	{
+		case kDistWidth_Byte:
+			DistMoments (mBytes, oSumDist, oSumDistSq);
+			break;
+		case kDistWidth_Short:
+			DistMoments (mShorts, oSumDist, oSumDistSq);
+			break;
+		default:
+			DistMoments (mInts, oSumDist, oSumDistSq);
+			break;
+	}
+}
+
+
+// *** END ***************************************************************/
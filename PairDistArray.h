@@ -0,0 +1,165 @@
+/**************************************************************************
+PairDistArray.h - the distances between pairs of isolates, held narrow
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- A distance over some loci is at most the number of loci, or twice that
+  for diploids, so for most datasets it fits in a byte and for nearly all
+  in a short. The array keeps its distances in the narrowest of a byte,
+  short or int that holds the largest distance possible, chosen when it
+  is reset. An array of a million pairs is then a megabyte, not four.
+- Each service asks the width once & runs a kernel for that width over
+  the whole array, so no cell is converted on its own.
+- Pairs are numbered as in MultiLocusModel::CalcIsoDistArray(), or in the
+  order of the rows given to SumRows().
+- Used by the fast engine only (see engine_t in MultiLocusModel.h).
+
+Changes:
+- Genotypes & different pairs are counted by streaming the distances
+  instead (see StreamIsoDistances() in PloidyPolicy.h).
+
+**************************************************************************/
+
+#ifndef PAIRDISTARRAY_H
+#define PAIRDISTARRAY_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "FlatMatrix.h"
+#include "PloidyPolicy.h"
+
+#include <vector>
+
+using std::vector;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+typedef unsigned short	ushort;
+
+// the width of the distances held
+enum distWidth_t
+{
+	kDistWidth_Byte,
+	kDistWidth_Short,
+	kDistWidth_Int
+};
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class PairDistArray
+{
+public:
+	// Lifecycle
+	PairDistArray ()
+		: mWidth (kDistWidth_Int), mNumPairs (0)
+		{}
+
+	// Access
+	ulong				size				() const	{ return mNumPairs; }
+	distWidth_t		GetWidth			() const	{ return mWidth; }
+	const vector<uchar>&		GetBytes		() const	{ return mBytes; }
+	const vector<ushort>&	GetShorts	() const	{ return mShorts; }
+	const vector<int>&		GetInts		() const	{ return mInts; }
+
+	// Services
+	void		Reset				(ulong iNumPairs, UInt iMaxDist);
+
+	template <typename CELL, typename METRIC>
+	void		AddLoci			(const FlatMatrix<CELL>& iData,
+										const vector<UInt>& iLoci, const METRIC& iMetric);
+	template <typename CELL, typename METRIC>
+	void		AddLocus			(const FlatMatrix<CELL>& iData, UInt iLocus,
+										const METRIC& iMetric, int iWeight);
+	template <typename CELL, typename METRIC>
+	void		SumRows			(const FlatMatrix<CELL>& iData,
+										const vector<UInt>& iRows, UInt iMaxDist,
+										const METRIC& iMetric);
+
+	void		CalcMoments		(double& oSumDist, double& oSumDistSq) const;
+
+private:
+	distWidth_t			mWidth;
+	ulong					mNumPairs;
+	vector<uchar>		mBytes;		// only that of the width is filled
+	vector<ushort>		mShorts;
+	vector<int>			mInts;
+};
+
+
+// *** TEMPLATE MEMBERS **************************************************/
+
+// ADD LOCI
+// Add the distances over the given loci to those of every pair.
+template <typename CELL, typename METRIC>
+void PairDistArray::AddLoci (const FlatMatrix<CELL>& iData,
+	const vector<UInt>& iLoci, const METRIC& iMetric)
+{
+	switch (mWidth)
+	{
+		case kDistWidth_Byte:
+			SumIsoDistances (iData, iLoci, iMetric, mBytes);
+			break;
+		case kDistWidth_Short:
+			SumIsoDistances (iData, iLoci, iMetric, mShorts);
+			break;
+		default:
+			SumIsoDistances (iData, iLoci, iMetric, mInts);
+			break;
+	}
+}
+
+
+// ADD LOCUS
+// Add the distances at one locus, or with a weight of -1 take them away.
+// A distance taken away must have been added, so none goes below 0.
+template <typename CELL, typename METRIC>
+void PairDistArray::AddLocus (const FlatMatrix<CELL>& iData, UInt iLocus,
+	const METRIC& iMetric, int iWeight)
+{
+	switch (mWidth)
+	{
+		case kDistWidth_Byte:
+			AddLocusDistances (iData, iLocus, iMetric, iWeight, mBytes);
+			break;
+		case kDistWidth_Short:
+			AddLocusDistances (iData, iLocus, iMetric, iWeight, mShorts);
+			break;
+		default:
+			AddLocusDistances (iData, iLocus, iMetric, iWeight, mInts);
+			break;
+	}
+}
+
+
+// SUM ROWS
+// Become the distances over all loci between the pairs of the given rows.
+template <typename CELL, typename METRIC>
+void PairDistArray::SumRows (const FlatMatrix<CELL>& iData,
+	const vector<UInt>& iRows, UInt iMaxDist, const METRIC& iMetric)
+{
+	Reset ((iRows.size() * (iRows.size() - 1)) / 2, iMaxDist);
+	switch (mWidth)
+	{
+		case kDistWidth_Byte:
+			SumRowDistances (iData, iRows, iMetric, mBytes);
+			break;
+		case kDistWidth_Short:
+			SumRowDistances (iData, iRows, iMetric, mShorts);
+			break;
+		default:
+			SumRowDistances (iData, iRows, iMetric, mInts);
+			break;
+	}
+}
+
+
+#endif
+// *** END ***************************************************************/
@@ -0,0 +1,180 @@
+/**************************************************************************
+PhaseTimer.cpp - timing where an analysis spends its time
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "PhaseTimer.h"
+
+#include <iomanip>
+
+using std::endl;
+using std::setw;
+using std::left;
+using std::right;
+using std::fixed;
+using std::setprecision;
+using std::ios;
+
+
+// *** CONSTANTS & DEFINES
+
+const char*	kPhaseNames[kPhase_Size] =
+{
+	"parse",
+	"var-distances",
+	"prep-rbars",
+	"iso-distances",
+	"genotypes",
+	"pair-sample",
+	"num-diff",
+	"porp-compat",
+	"index-assoc",
+	"rbars",
+	"pairwise",
+	"theta",
+	"partitions",
+	"plot-div",
+	"windows",
+	"jackknife",
+	"bootstrap",
+	"shuffle",
+	"backup-restore",
+	"output"
+};
+
+
+// *** MAIN BODY *********************************************************/
+
+// *** LIFECYCLE *********************************************************/
+
+PhaseProfile::PhaseProfile ()
+	: mSeconds (kPhase_Size, 0.0), mCalls (kPhase_Size, 0)
+{
+	mLastTick = phaseClock_t::now();
+}
+
+
+// *** SERVICES **********************************************************/
+
+void PhaseProfile::Clear ()
+{
+	mSeconds.assign (kPhase_Size, 0.0);
+	mCalls.assign (kPhase_Size, 0);
+}
+
+
+// CLEAR ANALYSIS
+// Forget everything but the parsing, which belongs to the dataset & not
+// to any one analysis of it.
+void PhaseProfile::ClearAnalysis ()
+{
+	for (int i = kPhase_Parse + 1; i < kPhase_Size; i++)
+	{
+		mSeconds[i] = 0.0;
+		mCalls[i] = 0;
+	}
+}
+
+
+void PhaseProfile::Enter (phase_t iPhase)
+{
+	assert ((0 <= iPhase) and (iPhase < kPhase_Size));
+	Flush ();
+	mRunning.push_back (iPhase);
+	mCalls[iPhase]++;
+}
+
+
+void PhaseProfile::Leave ()
+{
+	assert (not mRunning.empty());
+	Flush ();
+	mRunning.pop_back ();
+}
+
+
+// FLUSH
+// Charge the time since the last phase change to the innermost phase. Done
+// whenever a phase starts or ends, and before reading a profile while a
+// phase is still running.
+void PhaseProfile::Flush ()
+{
+	phaseClock_t::time_point theNow = phaseClock_t::now();
+	if (not mRunning.empty())
+	{
+		std::chrono::duration<double> theSpan = theNow - mLastTick;
+		mSeconds[mRunning.back()] += theSpan.count();
+	}
+	mLastTick = theNow;
+}
+
+
+// *** ACCESS ************************************************************/
+
+double PhaseProfile::GetSeconds (phase_t iPhase) const
+{
+	return mSeconds[iPhase];
+}
+
+
+unsigned long PhaseProfile::GetCalls (phase_t iPhase) const
+{
+	return mCalls[iPhase];
+}
+
+
+double PhaseProfile::GetTotalSeconds () const
+{
+	double theTotal = 0.0;
+	for (int i = 0; i < kPhase_Size; i++)
+		theTotal += mSeconds[i];
+	return theTotal;
+}
+
+
+const char* PhaseProfile::GetName (phase_t iPhase)
+{
+	assert ((0 <= iPhase) and (iPhase < kPhase_Size));
+	return kPhaseNames[iPhase];
+}
+
+
+// SUMMARIZE
+// A table of the phases that were used, with their share of the time.
+void PhaseProfile::Summarize (ostream& ioOutStream) const
+{
+	double theTotal = GetTotalSeconds ();
+	ios::fmtflags theOldFlags = ioOutStream.flags ();
+	std::streamsize theOldPrecision = ioOutStream.precision ();
+
+	ioOutStream << "Time spent in each phase:" << endl;
+	ioOutStream << fixed;
+	for (int i = 0; i < kPhase_Size; i++)
+	{
+		if (mCalls[i] == 0)
+			continue;
+		ioOutStream << "   " << left << setw (16) << kPhaseNames[i] << right
+			<< setw (10) << setprecision (3) << mSeconds[i] << " sec"
+			<< setw (7) << setprecision (1)
+			<< ((0.0 < theTotal) ? (100.0 * mSeconds[i] / theTotal) : 0.0)
+			<< "%" << setw (10) << mCalls[i] << " calls" << endl;
+	}
+	ioOutStream << "   " << left << setw (16) << "total" << right << setw (10)
+		<< setprecision (3) << theTotal << " sec" << endl;
+
+	ioOutStream.flags (theOldFlags);
+	ioOutStream.precision (theOldPrecision);
+}
+
+
+// *** END ***************************************************************/
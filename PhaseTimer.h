@@ -0,0 +1,120 @@
+/**************************************************************************
+PhaseTimer.h - timing where an analysis spends its time
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- A profile holds the time spent in, and the number of calls to, each of
+  the phases of an analysis (parsing, distance calculations, shuffling
+  etc.). A phase is timed by putting a ScopedPhase at its top.
+- Phases can nest, e.g. CalcNumDiff() calls CalcIsoDistArray(). Time is
+  only charged to the innermost phase running, so the times of all phases
+  add up to the time of the whole analysis.
+- Cheap enough to be left on: one clock reading each time a phase starts
+  or ends. Phases are whole functions, never single distances.
+
+**************************************************************************/
+
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+
+#include <vector>
+#include <iostream>
+#include <chrono>
+
+using std::vector;
+using std::ostream;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+enum phase_t
+{
+	kPhase_Parse = 0,
+	kPhase_VarDistances,
+	kPhase_PrepRBarS,
+	kPhase_IsoDistArray,
+	kPhase_Genotypes,
+	kPhase_PairSample,
+	kPhase_NumDiff,
+	kPhase_PorpCompat,
+	kPhase_IndexAssoc,
+	kPhase_RBarS,
+	kPhase_Pairwise,
+	kPhase_Theta,
+	kPhase_Partitions,
+	kPhase_PlotDiv,
+	kPhase_Windows,
+	kPhase_Jackknife,
+	kPhase_Bootstrap,
+	kPhase_Shuffle,
+	kPhase_BackupRestore,
+	kPhase_Output,
+	kPhase_Size
+};
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class PhaseProfile
+{
+public:
+	// Lifecycle
+	PhaseProfile	();
+
+	// Services
+	void				Clear				();
+	void				ClearAnalysis	();
+	void				Enter				(phase_t iPhase);
+	void				Leave				();
+	void				Flush				();
+
+	// Access
+	double			GetSeconds		(phase_t iPhase) const;
+	unsigned long	GetCalls			(phase_t iPhase) const;
+	double			GetTotalSeconds	() const;
+	static const char*	GetName	(phase_t iPhase);
+
+	void				Summarize		(ostream& ioOutStream) const;
+
+private:
+	typedef std::chrono::steady_clock	phaseClock_t;
+
+	vector<double>				mSeconds;
+	vector<unsigned long>	mCalls;
+	vector<phase_t>			mRunning;		// innermost last
+	phaseClock_t::time_point		mLastTick;
+};
+
+
+// SCOPED PHASE
+// Times the enclosing block as the given phase, however it is left.
+class ScopedPhase
+{
+public:
+	ScopedPhase (PhaseProfile& ioProfile, phase_t iPhase)
+		: mProfile (ioProfile)
+	{
+		mProfile.Enter (iPhase);
+	}
+
+	~ScopedPhase ()
+	{
+		mProfile.Leave ();
+	}
+
+private:
+	PhaseProfile&	mProfile;
+};
+
+
+#endif
+// *** END ***************************************************************/
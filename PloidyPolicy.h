@@ -0,0 +1,378 @@
+/**************************************************************************
+PloidyPolicy.h - the statistics kernels, specialised for haploid & diploid
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- The reference kernels in the model ask the ploidy of the data for every
+  cell they look at. Here each kernel is a template on the type of a cell
+  & a metric, which gives the distance between two cells at a locus. Each
+  kernel is instantiated once for haploid & once for diploid data, and the
+  model picks one of them at the start of each calculation.
+- Haploid distances take their cells by reference & test for missing
+  alleles without building strings. Diploid distances are looked up in the
+  tables of the model, by the diplotype of each cell at that locus (see
+  MultiLocusModel::InitLocusDTypes()). Both are otherwise exactly those of
+  the model, so the results are identical.
+- Used by the fast engine (see engine_t in MultiLocusModel.h), and for
+  estimates from sampled pairs of isolates under either engine.
+- Statistics that need only sums over the pairs of isolates, or only the
+  pairs at no distance, can be had without an array of distances, by
+  streaming the pairs through a reducer (see StreamIsoDistances()). Only
+  the reducer's own state is kept, which for the reducers here is at most
+  a count for each isolate.
+
+**************************************************************************/
+
+#ifndef PLOIDYPOLICY_H
+#define PLOIDYPOLICY_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "MultiLocusModel.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+using std::vector;
+using std::string;
+using std::sqrt;
+using std::max;
+using std::min;
+using std::count;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+// roughly how much of the data a tile of pairs should span, being the
+// rows of a tile & the rows they are paired with
+const UInt kPairTileBytes = 1 << 17;
+
+
+// *** PLOIDY POLICIES ***************************************************/
+
+// IS MISSING ALLELE
+// As MultiLocusModel::IsMissing(), for the unknown & gap symbols.
+inline bool IsMissingAllele (const string& iAllele)
+{
+	return ((iAllele.size() == 1) and
+		((iAllele[0] == '?') or (iAllele[0] == '-')));
+}
+
+
+// HAPLOID POLICY
+struct HaploidPolicy
+{
+	typedef tAllele	cell_t;
+
+	static int Distance (const cell_t& iCell1, const cell_t& iCell2)
+	{
+		return ((IsMissingAllele (iCell1) or IsMissingAllele (iCell2) or
+			(iCell1 == iCell2)) ? 0 : 1);
+	}
+
+	static int StrictDistance (const cell_t& iCell1, const cell_t& iCell2)
+	{
+		return ((IsMissingAllele (iCell1) or IsMissingAllele (iCell2) or
+			(iCell1 != iCell2)) ? 1 : 0);
+	}
+};
+
+
+// the relaxed & strict distances between haploid cells
+template <typename PLOIDY>
+struct RelaxedMetric
+{
+	int Between (UInt /* iLocus */, const typename PLOIDY::cell_t& iCell1,
+		const typename PLOIDY::cell_t& iCell2) const
+	{
+		return PLOIDY::Distance (iCell1, iCell2);
+	}
+};
+
+template <typename PLOIDY>
+struct StrictMetric
+{
+	int Between (UInt /* iLocus */, const typename PLOIDY::cell_t& iCell1,
+		const typename PLOIDY::cell_t& iCell2) const
+	{
+		return PLOIDY::StrictDistance (iCell1, iCell2);
+	}
+};
+
+
+// DIPLOTYPE METRIC
+// Diploid distances, from a table for each locus of the distances between
+// the diplotypes there. Pass the relaxed or strict tables of the model.
+class DiplotypeMetric
+{
+public:
+	DiplotypeMetric (const vector<UInt>& iNumDTypes,
+		const vector< vector<uchar> >& iDists)
+		: mNumDTypes (&iNumDTypes), mDists (&iDists)
+		{}
+
+	int Between (UInt iLocus, const tAllelePair& iCell1,
+		const tAllelePair& iCell2) const
+	{
+		return (*mDists)[iLocus][(iCell1.dtypeId * (*mNumDTypes)[iLocus]) +
+			iCell2.dtypeId];
+	}
+
+private:
+	const vector<UInt>*					mNumDTypes;
+	const vector< vector<uchar> >*	mDists;
+};
+
+
+// *** KERNELS ***********************************************************/
+
+// SUM ISOLATE DISTANCES
+// For every pair of isolates, in the order of CalcIsoDistArray(), add the
+// distances over the given loci. The distances may be held in any width
+// that holds their sums (see PairDistArray.h).
+template <typename CELL, typename METRIC, typename DIST>
+void SumIsoDistances (const FlatMatrix<CELL>& iData, const vector<UInt>& iLoci,
+	const METRIC& iMetric, vector<DIST>& ioDistArray)
+{
+	UInt theNumIso = iData.size();
+	UInt theNumLoci = iLoci.size();
+	long thePairNum = 0;
+
+	for (UInt i = 0; i + 1 < theNumIso; i++)
+	{
+		const CELL* theRowI = iData[i];
+		for (UInt j = i + 1; j < theNumIso; j++)
+		{
+			const CELL* theRowJ = iData[j];
+			int theDist = 0;
+			for (UInt k = 0; k < theNumLoci; k++)
+				theDist += iMetric.Between (iLoci[k], theRowI[iLoci[k]],
+					theRowJ[iLoci[k]]);
+			ioDistArray[thePairNum] += theDist;
+			thePairNum++;
+		}
+	}
+}
+
+
+// SUM ROW DISTANCES
+// As SumIsoDistances() over all loci, but for the pairs of the given
+// isolates only, in the order given.
+template <typename CELL, typename METRIC, typename DIST>
+void SumRowDistances (const FlatMatrix<CELL>& iData, const vector<UInt>& iRows,
+	const METRIC& iMetric, vector<DIST>& oDistArray)
+{
+	UInt theNumRows = iRows.size();
+	UInt theNumLoci = iData.GetNumCols();
+	long thePairNum = 0;
+
+	oDistArray.assign ((ulong (theNumRows) * (theNumRows - 1)) / 2, 0);
+	for (UInt i = 0; i + 1 < theNumRows; i++)
+	{
+		const CELL* theRowI = iData[iRows[i]];
+		for (UInt j = i + 1; j < theNumRows; j++, thePairNum++)
+		{
+			const CELL* theRowJ = iData[iRows[j]];
+			int theDist = 0;
+			for (UInt k = 0; k < theNumLoci; k++)
+				theDist += iMetric.Between (k, theRowI[k], theRowJ[k]);
+			oDistArray[thePairNum] = theDist;
+		}
+	}
+}
+
+
+// ADD LOCUS DISTANCES
+// Add the distances at one locus to those of every pair of isolates, in
+// the order of CalcIsoDistArray(), or with a weight of -1 take them away.
+template <typename CELL, typename METRIC, typename DIST>
+void AddLocusDistances (const FlatMatrix<CELL>& iData, UInt iLocus,
+	const METRIC& iMetric, int iWeight, vector<DIST>& ioDistArray)
+{
+	UInt theNumIso = iData.size();
+	long thePairNum = 0;
+
+	for (UInt i = 0; i + 1 < theNumIso; i++)
+	{
+		const CELL& theCell = iData[i][iLocus];
+		for (UInt j = i + 1; j < theNumIso; j++, thePairNum++)
+			ioDistArray[thePairNum] += iWeight *
+				iMetric.Between (iLocus, theCell, iData[j][iLocus]);
+	}
+}
+
+
+// STREAM ISOLATE DISTANCES
+// Give the distance over the given loci between every pair of isolates
+// to a reducer, as ioReducer.Add (i, j, dist), without holding them. The
+// pairs are visited a tile at a time, a block of rows against a block of
+// the rows after, so both blocks stay in the cache while every pair
+// between them is summed. The tiles of each block of rows are visited in
+// order from the diagonal, & the rows of a tile in order, so every pair
+// (i, j) comes after every pair (h, j) or (h, i) for h before i, as in
+// the order of CalcIsoDistArray().
+template <typename CELL, typename METRIC, typename REDUCER>
+void StreamIsoDistances (const FlatMatrix<CELL>& iData,
+	const vector<UInt>& iLoci, const METRIC& iMetric, REDUCER& ioReducer)
+{
+	UInt theNumIso = iData.size();
+	UInt theNumLoci = iLoci.size();
+	UInt theRowBytes = max (UInt (theNumLoci * sizeof (CELL)), UInt (1));
+	UInt theTileRows = max (kPairTileBytes / (2 * theRowBytes), UInt (1));
+
+	for (UInt theFirstRow = 0; theFirstRow + 1 < theNumIso;
+		theFirstRow += theTileRows)
+	{
+		UInt theEndRow = min (theFirstRow + theTileRows, theNumIso);
+		for (UInt theFirstCol = theFirstRow; theFirstCol < theNumIso;
+			theFirstCol += theTileRows)
+		{
+			UInt theEndCol = min (theFirstCol + theTileRows, theNumIso);
+			for (UInt i = theFirstRow; i < theEndRow; i++)
+			{
+				const CELL* theRowI = iData[i];
+				for (UInt j = max (i + 1, theFirstCol); j < theEndCol; j++)
+				{
+					const CELL* theRowJ = iData[j];
+					int theDist = 0;
+					for (UInt k = 0; k < theNumLoci; k++)
+						theDist += iMetric.Between (iLoci[k], theRowI[iLoci[k]],
+							theRowJ[iLoci[k]]);
+					ioReducer.Add (i, j, theDist);
+				}
+			}
+		}
+	}
+}
+
+
+// SAMPLE VARIANCE OF DISTANCES
+// The variance of distances over all loci, over the given pairs of
+// isolates (two to a pair) as though they were every pair, & its standard
+// error. The deviations from the mean are taken in a second pass, so the
+// sums of powers stay small.
+template <typename CELL, typename METRIC>
+void SampleVarDist (const FlatMatrix<CELL>& iData, const vector<UInt>& iPairs,
+	const METRIC& iMetric, PairSample& oSample)
+{
+	UInt			theNumLoci = iData.GetNumCols();
+	UInt			theNumPairs = iPairs.size() / 2;
+	vector<int>	theDists (theNumPairs, 0);
+	double		theSumDist = 0.0;
+
+	for (UInt p = 0; p < theNumPairs; p++)
+	{
+		const CELL* theRow1 = iData[iPairs[2 * p]];
+		const CELL* theRow2 = iData[iPairs[(2 * p) + 1]];
+		for (UInt k = 0; k < theNumLoci; k++)
+			theDists[p] += iMetric.Between (k, theRow1[k], theRow2[k]);
+		theSumDist += theDists[p];
+	}
+
+	double theMeanDist = theSumDist / theNumPairs;
+	double theSumDevSq = 0.0, theSumDevQuad = 0.0;
+	for (UInt p = 0; p < theNumPairs; p++)
+	{
+		double theDevSq = (theDists[p] - theMeanDist) * (theDists[p] - theMeanDist);
+		theSumDevSq += theDevSq;
+		theSumDevQuad += theDevSq * theDevSq;
+	}
+
+	oSample.mNumPairs = theNumPairs;
+	oSample.mVarDist = theSumDevSq / theNumPairs;
+	oSample.mVarDistError = sqrt (max (theSumDevQuad / theNumPairs -
+		oSample.mVarDist * oSample.mVarDist, 0.0) / theNumPairs);
+}
+
+
+// *** PAIR REDUCERS *****************************************************/
+
+// PAIR MOMENTS
+// The number of pairs, the sums of their distances & of the squares of
+// those, & the number of pairs at some distance.
+struct PairMoments
+{
+	double	mNumPairs;
+	double	mSumDist;
+	double	mSumDistSq;
+	double	mNumDiffPairs;
+
+	PairMoments ()
+		: mNumPairs (0.0), mSumDist (0.0), mSumDistSq (0.0), mNumDiffPairs (0.0)
+		{}
+
+	void Add (UInt /* iIso1 */, UInt /* iIso2 */, int iDist)
+	{
+		double theDist = iDist;
+		mNumPairs += 1.0;
+		mSumDist += theDist;
+		mSumDistSq += theDist * theDist;
+		if (iDist != 0)
+			mNumDiffPairs += 1.0;
+	}
+};
+
+
+// ZERO PAIR CLUSTERS
+// How often genotypes occur, as MultiLocusModel::CountFreqsFromDist()
+// counts them. Each isolate not yet taken into an earlier one takes in
+// every isolate after it, not yet taken, at no distance from it. The pairs
+// must come in the order of StreamIsoDistances().
+class ZeroPairClusters
+{
+public:
+	ZeroPairClusters (UInt iNumIso)
+		: mGtypeFreq (iNumIso, 1)
+		{}
+
+	void Add (UInt iIso1, UInt iIso2, int iDist)
+	{
+		if ((iDist == 0) and mGtypeFreq[iIso1] and mGtypeFreq[iIso2])
+		{
+			mGtypeFreq[iIso2] = 0;
+			mGtypeFreq[iIso1]++;
+		}
+	}
+
+	const vector<int>&	GetFreqs () const	{ return mGtypeFreq; }
+
+	UInt CountGtypes () const
+	{
+		return mGtypeFreq.size() - count (mGtypeFreq.begin(), mGtypeFreq.end(), 0);
+	}
+
+private:
+	vector<int>		mGtypeFreq;
+};
+
+
+// BOTH REDUCERS
+// Gives every pair to two reducers, so one pass serves both.
+template <typename REDUCER1, typename REDUCER2>
+struct BothReducers
+{
+	REDUCER1&	mFirst;
+	REDUCER2&	mSecond;
+
+	BothReducers (REDUCER1& ioFirst, REDUCER2& ioSecond)
+		: mFirst (ioFirst), mSecond (ioSecond)
+		{}
+
+	void Add (UInt iIso1, UInt iIso2, int iDist)
+	{
+		mFirst.Add (iIso1, iIso2, iDist);
+		mSecond.Add (iIso1, iIso2, iDist);
+	}
+};
+
+
+#endif
+// *** END ***************************************************************/
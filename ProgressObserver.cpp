@@ -0,0 +1,185 @@
+/**************************************************************************
+ProgressObserver.cpp - reporting the progress of long randomization runs
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "ProgressObserver.h"
+#include "Error.h"
+
+#include <iostream>
+#include <iomanip>
+
+using std::cout;
+using std::endl;
+using std::ios;
+using std::fixed;
+using std::setprecision;
+using sbl::FileOpenError;
+
+
+// *** MAIN BODY *********************************************************/
+
+// *** PROGRESS OBSERVER *************************************************/
+#pragma mark --
+
+// by default, only the progress is of interest
+void ProgressObserver::RunStarted (const ProgressReport& iReport)
+{
+	(void) iReport;
+}
+
+
+void ProgressObserver::RunFinished (const ProgressReport& iReport)
+{
+	(void) iReport;
+}
+
+
+void ProgressObserver::PhasesTimed
+(const string& iAnalysis, const PhaseProfile& iProfile)
+{
+	(void) iAnalysis;
+	(void) iProfile;
+}
+
+
+// *** CONSOLE PROGRESS **************************************************/
+#pragma mark --
+
+void ConsoleProgress::ReplicatesDone (const ProgressReport& iReport)
+{
+	cout << "Doing randomization " << iReport.mReplicate << " of "
+		<< iReport.mNumRandomizations << " ...";
+	if (0.0 < iReport.mRate)
+	{
+		cout << " (" << fixed << setprecision (1) << iReport.mRate
+			<< " per sec";
+		if (0.0 <= iReport.mRemaining)
+			cout << ", about " << setprecision (0) << iReport.mRemaining
+				<< " sec to go";
+		cout << ")";
+		cout.unsetf (ios::floatfield);
+		cout << setprecision (6);
+	}
+	cout << endl;
+}
+
+
+void ConsoleProgress::PhasesTimed
+(const string& iAnalysis, const PhaseProfile& iProfile)
+{
+	(void) iAnalysis;
+	iProfile.Summarize (cout);
+}
+
+
+// *** JSON LINES PROGRESS ***********************************************/
+#pragma mark --
+
+JsonLinesProgress::~JsonLinesProgress ()
+{
+	Close ();
+}
+
+
+void JsonLinesProgress::Open (const char* iPath)
+{
+	Close ();
+	mOutStream.open (iPath);
+	if (not mOutStream)
+		throw FileOpenError ("couldn't open progress log", iPath);
+}
+
+
+void JsonLinesProgress::Close ()
+{
+	if (mOutStream.is_open())
+		mOutStream.close ();
+	mOutStream.clear ();
+}
+
+
+bool JsonLinesProgress::IsOpen ()
+{
+	return mOutStream.is_open();
+}
+
+
+void JsonLinesProgress::RunStarted (const ProgressReport& iReport)
+{
+	WriteEvent ("start", iReport);
+}
+
+
+void JsonLinesProgress::ReplicatesDone (const ProgressReport& iReport)
+{
+	WriteEvent ("progress", iReport);
+}
+
+
+void JsonLinesProgress::RunFinished (const ProgressReport& iReport)
+{
+	WriteEvent ("finish", iReport);
+}
+
+
+// PHASES TIMED
+// As a single event, with the seconds & calls for each phase used.
+void JsonLinesProgress::PhasesTimed
+(const string& iAnalysis, const PhaseProfile& iProfile)
+{
+	if (not mOutStream.is_open())
+		return;
+
+	mOutStream << "{\"event\": \"phases\", \"analysis\": \"" << iAnalysis
+		<< "\", \"total\": " << iProfile.GetTotalSeconds();
+	for (int i = 0; i < kPhase_Size; i++)
+	{
+		phase_t thePhase = phase_t (i);
+		if (iProfile.GetCalls (thePhase) == 0)
+			continue;
+		mOutStream << ", \"" << PhaseProfile::GetName (thePhase)
+			<< "\": {\"seconds\": " << iProfile.GetSeconds (thePhase)
+			<< ", \"calls\": " << iProfile.GetCalls (thePhase) << "}";
+	}
+	mOutStream << "}" << endl;
+}
+
+
+// WRITE EVENT
+// Analysis names are plain words, so need no escaping. Each line is
+// flushed, so that the log can be followed while the run goes on.
+void JsonLinesProgress::WriteEvent
+(const char* iEvent, const ProgressReport& iReport)
+{
+	if (not mOutStream.is_open())
+		return;
+
+	mOutStream << "{\"event\": \"" << iEvent << "\""
+		<< ", \"analysis\": \"" << iReport.mAnalysis << "\""
+		<< ", \"replicate\": " << iReport.mReplicate
+		<< ", \"first\": " << iReport.mFirstRep
+		<< ", \"last\": " << iReport.mLastRep
+		<< ", \"total\": " << iReport.mNumRandomizations
+		<< ", \"done\": " << iReport.mNumDone
+		<< ", \"elapsed\": " << iReport.mElapsed
+		<< ", \"rate\": " << iReport.mRate;
+	if (0.0 <= iReport.mRemaining)
+		mOutStream << ", \"remaining\": " << iReport.mRemaining;
+	else
+		mOutStream << ", \"remaining\": null";
+	mOutStream << "}" << endl;
+}
+
+
+// *** END ***************************************************************/
@@ -0,0 +1,114 @@
+/**************************************************************************
+ProgressObserver.h - reporting the progress of long randomization runs
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- The model used to print "Doing randomization i of N" straight to cout,
+  which broke the model-app barrier. Now it tells any number of observers
+  how far it has got, and they decide what to make of it.
+- Each report carries the elapsed time, the rate of replicates and an
+  estimate of the time left, so that users can size jobs & spot slow
+  machines.
+- At the end of each analysis, observers are also shown the profile of
+  where the time went (see PhaseTimer.h).
+- Two observers are provided: one writing to the console as before, one
+  writing a line of JSON per report for other programs to digest.
+- Observers are not owned by the model, and must outlive their
+  subscription.
+
+**************************************************************************/
+
+#ifndef PROGRESSOBSERVER_H
+#define PROGRESSOBSERVER_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "PhaseTimer.h"
+
+#include <string>
+#include <fstream>
+
+using std::string;
+using std::ofstream;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+// everything known about a run at the time of a report
+struct ProgressReport
+{
+	string	mAnalysis;				// e.g. "diversity" or "theta"
+	UInt		mFirstRep;				// the replicates to be done in this run
+	UInt		mLastRep;
+	UInt		mNumRandomizations;	// in the whole job
+	UInt		mReplicate;				// the last one completed
+	UInt		mNumDone;				// done in this run, may be less if resumed
+	double	mElapsed;				// seconds since the run started
+	double	mRate;					// replicates per second
+	double	mRemaining;				// estimated seconds left, < 0 if unknown
+};
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class ProgressObserver
+{
+public:
+	// Lifecycle
+	virtual ~ProgressObserver	() {}
+
+	// Services
+	virtual void	RunStarted			(const ProgressReport& iReport);
+	virtual void	ReplicatesDone		(const ProgressReport& iReport) = 0;
+	virtual void	RunFinished			(const ProgressReport& iReport);
+	virtual void	PhasesTimed			(const string& iAnalysis,
+													const PhaseProfile& iProfile);
+};
+
+
+// CONSOLE PROGRESS
+// The old message, with the rate & time left added.
+class ConsoleProgress : public ProgressObserver
+{
+public:
+	void	ReplicatesDone		(const ProgressReport& iReport);
+	void	PhasesTimed			(const string& iAnalysis,
+										const PhaseProfile& iProfile);
+};
+
+
+// JSON LINES PROGRESS
+// One JSON object per line for every event, to a file. Until the file is
+// opened, or after it's closed, reports are ignored.
+class JsonLinesProgress : public ProgressObserver
+{
+public:
+	// Lifecycle
+	~JsonLinesProgress	();
+
+	// Services
+	void	Open				(const char* iPath);
+	void	Close				();
+	bool	IsOpen			();
+
+	void	RunStarted		(const ProgressReport& iReport);
+	void	ReplicatesDone	(const ProgressReport& iReport);
+	void	RunFinished		(const ProgressReport& iReport);
+	void	PhasesTimed		(const string& iAnalysis,
+									const PhaseProfile& iProfile);
+
+private:
+	ofstream		mOutStream;
+
+	void	WriteEvent		(const char* iEvent, const ProgressReport& iReport);
+};
+
+
+#endif
+// *** END ***************************************************************/
@@ -0,0 +1,288 @@
+/**************************************************************************
+ShardMerge.cpp - combining the results of a randomization run done in pieces
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. A shard file is read as three parts: the preamble (header,
+  settings, data and observed results, which must be identical in every
+  shard), the rows of replicates, and the trailer giving the shard's place
+  in the job and its counts.
+
+To Do:
+- merge the pairwise (.pairs) and partition (.part) results as well.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "ShardMerge.h"
+#include "Sbl.h"
+#include "Error.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+using std::endl;
+using std::ios;
+using sbl::Error;
+using sbl::FormatError;
+using sbl::FileOpenError;
+using sbl::FileWriteError;
+using sbl::UInt;
+
+
+// *** CONSTANTS & DEFINES
+
+enum resultsFile_t
+{
+	kResults_Stats,
+	kResults_Theta
+};
+
+// the column of rBarS in the stats p-values, which is two-tailed
+const int	kStatsCol_RBarS		= 6;
+
+struct ShardResults
+{
+	vector<string>	mPreamble;
+	vector<string>	mReplicates;
+	int				mShardNum;			// counting from 1 as printed
+	int				mNumShards;
+	long				mFirstRep;
+	long				mLastRep;
+	long				mNumRandomizations;
+	long				mRunSeed;
+	vector<long>	mExceedances;
+};
+
+
+// *** LOCAL FUNCTIONS ***************************************************/
+
+// IS REPLICATE ROW
+// Stats replicates are rows starting with their number, theta replicates
+// are labelled.
+static bool IsReplicateRow (const string& iLine, resultsFile_t iFileType)
+{
+	if (iFileType == kResults_Theta)
+		return (iLine.compare (0, 15, "Randomization #") == 0);
+	else
+		return ((0 < iLine.size()) and isdigit (iLine[0]));
+}
+
+
+static bool StartsWith (const string& iLine, const char* iPrefix)
+{
+	return (iLine.compare (0, string (iPrefix).size(), iPrefix) == 0);
+}
+
+
+// READ SHARD
+// Divide a shard file into its parts. The observed result (the "Observed"
+// row of a stats file or the "Theta:" line of a theta file) shows what
+// sort of results are being read and where the preamble ends.
+static void ReadShard
+(const string& iPath, resultsFile_t& oFileType, ShardResults& oShard)
+{
+	ifstream theInStrm (iPath.c_str());
+	if (not theInStrm)
+		throw FileOpenError ("couldn't open shard results", iPath.c_str());
+
+	vector<string>	theLines;
+	string			theLine;
+	while (std::getline (theInStrm, theLine))
+		theLines.push_back (theLine);
+
+	// find the trailer, which is the last thing in the file
+	long theTrailerPosn = long (theLines.size()) - 1;
+	while ((0 <= theTrailerPosn) and
+		not StartsWith (theLines[theTrailerPosn], "Shard\t"))
+		theTrailerPosn--;
+	if ((theTrailerPosn < 0) or (long (theLines.size()) < theTrailerPosn + 3))
+		throw FormatError ("results file is not from a shard");
+
+	// read the trailer
+	string	theWord;
+	istringstream theShardStrm (theLines[theTrailerPosn]);
+	theShardStrm >> theWord >> oShard.mShardNum >> theWord >> oShard.mNumShards
+		>> theWord >> oShard.mFirstRep >> theWord >> oShard.mLastRep
+		>> theWord >> oShard.mNumRandomizations;
+	istringstream theSeedStrm (theLines[theTrailerPosn + 1]);
+	theSeedStrm >> theWord >> oShard.mRunSeed;
+	if (theShardStrm.fail() or theSeedStrm.fail() or (theWord != "Seed") or
+		not StartsWith (theLines[theTrailerPosn + 2], "Exceedances"))
+		throw FormatError ("badly formed shard trailer");
+
+	istringstream theCountStrm (theLines[theTrailerPosn + 2]);
+	theCountStrm >> theWord;
+	long theCount;
+	oShard.mExceedances.clear();
+	while (theCountStrm >> theCount)
+		oShard.mExceedances.push_back (theCount);
+
+	// the trailer is preceded by a blank line
+	long theBodyEnd = theTrailerPosn;
+	if ((0 < theBodyEnd) and (theLines[theBodyEnd - 1] == ""))
+		theBodyEnd--;
+
+	// find the observed result & so the type of file
+	long theObsPosn = 0;
+	while ((theObsPosn < theBodyEnd) and
+		not StartsWith (theLines[theObsPosn], "Observed\t") and
+		not StartsWith (theLines[theObsPosn], "Theta:\t"))
+		theObsPosn++;
+	if (theObsPosn == theBodyEnd)
+		throw FormatError ("shard is neither diversity nor theta results");
+	oFileType = StartsWith (theLines[theObsPosn], "Theta:\t") ?
+		kResults_Theta : kResults_Stats;
+
+	// everything up to the first replicate is preamble
+	long theRepPosn = theObsPosn + 1;
+	while ((theRepPosn < theBodyEnd) and
+		not IsReplicateRow (theLines[theRepPosn], oFileType))
+		theRepPosn++;
+	oShard.mPreamble.assign (theLines.begin(), theLines.begin() + theRepPosn);
+	oShard.mReplicates.assign (theLines.begin() + theRepPosn,
+		theLines.begin() + theBodyEnd);
+}
+
+
+// IS RBARS CALCULATED
+// If the data couldn't be ranked, the observed rBarS is given as "N/A".
+static bool IsRBarSCalculated (const vector<string>& iPreamble)
+{
+	for (UInt i = 0; i < iPreamble.size(); i++)
+	{
+		if (StartsWith (iPreamble[i], "Observed\t"))
+		{
+			string::size_type theLastTab = iPreamble[i].rfind ('\t');
+			return (iPreamble[i].substr (theLastTab + 1) != "N/A");
+		}
+	}
+	return false;
+}
+
+
+static bool CompareShardNums (const ShardResults& iLeft,
+	const ShardResults& iRight)
+{
+	return (iLeft.mShardNum < iRight.mShardNum);
+}
+
+
+// *** MAIN BODY *********************************************************/
+
+// MERGE SHARD RESULTS
+// The p-values written are formatted exactly as the model does for an
+// unsplit run, so the merged file is indistinguishable from one.
+void MergeShardResults
+(const vector<string>& iShardPaths, const char* iMergedPath)
+{
+	if (iShardPaths.size() == 0)
+		throw Error ("no shards to merge");
+
+	// 1. read & check all the shards
+	vector<ShardResults>	theShards (iShardPaths.size());
+	resultsFile_t			theFileType = kResults_Stats;
+	for (UInt i = 0; i < iShardPaths.size(); i++)
+	{
+		resultsFile_t theShardType;
+		ReadShard (iShardPaths[i], theShardType, theShards[i]);
+		if (i == 0)
+			theFileType = theShardType;
+		else if ((theShardType != theFileType) or
+			(theShards[i].mPreamble != theShards[0].mPreamble))
+			throw Error ("shards are not from the same analysis & data");
+		else if ((theShards[i].mNumShards != theShards[0].mNumShards) or
+			(theShards[i].mNumRandomizations != theShards[0].mNumRandomizations) or
+			(theShards[i].mRunSeed != theShards[0].mRunSeed) or
+			(theShards[i].mExceedances.size() != theShards[0].mExceedances.size()))
+			throw Error ("shards are not from the same job");
+	}
+
+	std::sort (theShards.begin(), theShards.end(), CompareShardNums);
+	if (long (theShards.size()) != theShards[0].mNumShards)
+		throw Error ("the number of shards given is not the number in the job");
+	long theNextRep = 1;
+	for (UInt i = 0; i < theShards.size(); i++)
+	{
+		if ((theShards[i].mShardNum != int (i + 1)) or
+			(theShards[i].mFirstRep != theNextRep))
+			throw Error ("shards are missing or repeated");
+		theNextRep = theShards[i].mLastRep + 1;
+	}
+	long theNumRandomizations = theShards[0].mNumRandomizations;
+	if (theNextRep != theNumRandomizations + 1)
+		throw Error ("shards do not cover all the randomizations");
+
+	// 2. add up the counts
+	vector<long> theExceedances (theShards[0].mExceedances.size(), 0);
+	for (UInt i = 0; i < theShards.size(); i++)
+		for (UInt j = 0; j < theExceedances.size(); j++)
+			theExceedances[j] += theShards[i].mExceedances[j];
+
+	// 3. write out the merged results
+	ofstream theOutStrm (iMergedPath);
+	if (not theOutStrm)
+		throw FileOpenError ("couldn't open merged results", iMergedPath);
+	theOutStrm.setf (ios::showpoint);
+
+	const vector<string>& thePreamble = theShards[0].mPreamble;
+	for (UInt i = 0; i < thePreamble.size(); i++)
+		theOutStrm << thePreamble[i] << endl;
+	for (UInt i = 0; i < theShards.size(); i++)
+		for (UInt j = 0; j < theShards[i].mReplicates.size(); j++)
+			theOutStrm << theShards[i].mReplicates[j] << endl;
+
+	double theNumReps = double (theNumRandomizations);
+	theOutStrm << endl;
+	if (theFileType == kResults_Theta)
+	{
+		theOutStrm << "P value:\t";
+		if (theExceedances[0] == 0)
+			theOutStrm << "< " << (1.0 / theNumReps);
+		else
+			theOutStrm << double (theExceedances[0] / theNumReps);
+	}
+	else
+	{
+		bool theRBarSIsCalc = IsRBarSCalculated (thePreamble);
+		theOutStrm << "P_Values";
+		for (UInt i = 0; i < theExceedances.size(); i++)
+		{
+			theOutStrm << "\t";
+			if (int (i) == kStatsCol_RBarS)
+			{
+				if (not theRBarSIsCalc)
+					theOutStrm << "N/A";
+				else if (theExceedances[i] == 0)
+					theOutStrm << "< " << (2.0 / theNumReps);
+				else
+					theOutStrm << (2 * double (theExceedances[i]) / theNumReps);
+			}
+			else
+			{
+				if (theExceedances[i] == 0)
+					theOutStrm << "< " << (1.0 / theNumReps);
+				else
+					theOutStrm << (double (theExceedances[i]) / theNumReps);
+			}
+		}
+	}
+	theOutStrm << endl;
+
+	theOutStrm.close();
+	if (not theOutStrm)
+		throw FileWriteError ("couldn't write merged results", iMergedPath);
+}
+
+
+// *** END ***************************************************************/
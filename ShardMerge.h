@@ -0,0 +1,42 @@
+/**************************************************************************
+ShardMerge.h - combining the results of a randomization run done in pieces
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- A long randomization job can be split into shards, each a separate run
+  of the program (possibly on a different machine) doing a contiguous
+  slice of the replicates. Each shard writes the observed results and its
+  own replicates, but where the p-values would be it gives the counts of
+  replicates as extreme as the observed data (see
+  MultiLocusModel::OutputShardCounts()).
+- Merging checks that the shards were of the same data & settings, and
+  between them cover every replicate once, then writes a single results
+  file as the unsplit run would have, with p-values from the summed counts.
+- Handles diversity (.stats) and theta (.theta) results.
+
+**************************************************************************/
+
+#ifndef SHARDMERGE_H
+#define SHARDMERGE_H
+
+
+// *** INCLUDES
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+// *** FUNCTION DECLARATIONS *********************************************/
+
+void	MergeShardResults	(const vector<string>& iShardPaths,
+									const char* iMergedPath);
+
+
+#endif
+// *** END ***************************************************************/
@@ -0,0 +1,676 @@
+/**************************************************************************
+Bench.cpp - timing the main calculations over synthetic datasets
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- A separate program, built & run by "make bench", so that the speed of
+  the calculations can be followed from version to version & any change
+  meant to speed them up can be shown to do so.
+- Each benchmark is run several times on a freshly loaded model with a
+  fixed seed, so the work done is the same every time. The best & mean
+  times are reported, with the phase profile (see PhaseTimer.h) of the
+  best run.
+- Results are written as one JSON object per line, for other programs to
+  digest & compare.
+- "multilocus-bench generate <file> [options]" just writes a synthetic
+  dataset, for trying by hand or in the application.
+- "multilocus-bench verify [options] [datasets]" checks the kernels of an
+  engine against the reference, see KernelCheck.h. The exit status is
+  non-zero if any differ by more than the tolerance.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "SyntheticData.h"
+#include "QuietConsole.h"
+#include "KernelCheck.h"
+#include "MultiLocusModel.h"
+#include "Error.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::ostream;
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+using std::string;
+using std::vector;
+using sbl::Error;
+using sbl::FileOpenError;
+
+
+// *** CONSTANTS & DEFINES
+
+#ifndef VERSION_HASH
+	#define VERSION_HASH		"unknown"
+#endif
+
+typedef std::chrono::steady_clock	benchClock_t;
+
+// searching for partitions is exponential in the number of isolates
+const UInt	kMaxPartIsolates		= 16;
+
+// loci in each window, moved a locus at a time
+const UInt	kWindowWidth			= 10;
+
+const char*	kScratchDataPath		= "multilocus-bench.txt";
+const char*	kScratchResultsPath	= "multilocus-bench.out";
+
+// as "make bench" runs it, from the top of the source
+const char*	kBaselineGoldenPath	= "bench/baseline.golden";
+
+struct BenchSettings
+{
+	engine_t	mEngine;
+	UInt		mNumRandomizations;	// for diversity & theta
+	UInt		mNumPartRandomizations;
+	UInt		mNumPlotSamples;
+	UInt		mNumRepeats;
+	UInt		mNumThreads;			// for bootstrap, 0 for the model's own choice
+	double	mPairSampleError;		// for variances, 0 for every pair
+	string	mOnly;					// comma-separated benchmarks, or all
+};
+
+struct BenchResult
+{
+	double		mBest;
+	double		mTotal;
+	PhaseProfile	mBestProfile;
+	bool			mHasProfile;
+};
+
+
+// *** LOCAL FUNCTIONS ***************************************************/
+
+static double SecondsSince (benchClock_t::time_point iStart)
+{
+	std::chrono::duration<double> theSpan = benchClock_t::now() - iStart;
+	return theSpan.count();
+}
+
+
+static bool IsWanted (const BenchSettings& iSettings, const char* iName)
+{
+	if (iSettings.mOnly.empty())
+		return true;
+	string theList = "," + iSettings.mOnly + ",";
+	return (theList.find (string (",") + iName + ",") != string::npos);
+}
+
+
+static void LoadModel (const SyntheticSpec& iSpec, MultiLocusModel& ioModel)
+{
+	ifstream theInStrm (kScratchDataPath);
+	if (not theInStrm)
+		throw FileOpenError ("couldn't open synthetic data", kScratchDataPath);
+	ioModel.ParseInput (theInStrm, kScratchDataPath);
+	SetSyntheticParts (iSpec, ioModel);
+	ioModel.SetRunSeed (iSpec.mSeed);
+}
+
+
+static void WriteSpec (ostream& ioOutStream, const SyntheticSpec& iSpec)
+{
+	ioOutStream << "\"ploidy\": \""
+		<< ((iSpec.mPloidy == kPloidy_Diploid) ? "diploid" : "haploid") << "\""
+		<< ", \"isolates\": " << iSpec.mNumIsolates
+		<< ", \"loci\": " << iSpec.mNumLoci
+		<< ", \"alleles\": " << iSpec.mNumAlleles
+		<< ", \"missing\": " << iSpec.mMissingRate
+		<< ", \"pops\": " << iSpec.mNumPops
+		<< ", \"linkages\": " << iSpec.mNumLinkages
+		<< ", \"profiles\": " << iSpec.mNumProfiles
+		<< ", \"seed\": " << iSpec.mSeed;
+}
+
+
+// WRITE RESULT
+// The time per unit is per replicate for the randomizations (counting the
+// observed data as one), and per call otherwise.
+static void WriteResult (ostream& ioOutStream, const char* iBench,
+	const SyntheticSpec& iSpec, const BenchSettings& iSettings,
+	UInt iNumUnits, const BenchResult& iResult)
+{
+	ioOutStream << "{\"bench\": \"" << iBench << "\""
+		<< ", \"version\": \"" << VERSION_HASH << "\""
+		<< ", \"engine\": \"" << GetEngineName (iSettings.mEngine) << "\", ";
+	WriteSpec (ioOutStream, iSpec);
+	ioOutStream << ", \"units\": " << iNumUnits
+		<< ", \"repeats\": " << iSettings.mNumRepeats
+		<< ", \"best\": " << iResult.mBest
+		<< ", \"mean\": " << (iResult.mTotal / iSettings.mNumRepeats)
+		<< ", \"per_unit\": " << (iResult.mBest / iNumUnits);
+	if (iResult.mHasProfile)
+	{
+		ioOutStream << ", \"phases\": {";
+		bool theIsFirst = true;
+		for (int i = kPhase_Parse + 1; i < kPhase_Size; i++)
+		{
+			phase_t thePhase = phase_t (i);
+			if (iResult.mBestProfile.GetCalls (thePhase) == 0)
+				continue;
+			if (not theIsFirst)
+				ioOutStream << ", ";
+			ioOutStream << "\"" << PhaseProfile::GetName (thePhase) << "\": "
+				<< iResult.mBestProfile.GetSeconds (thePhase);
+			theIsFirst = false;
+		}
+		ioOutStream << "}";
+	}
+	ioOutStream << "}" << endl;
+}
+
+
+static void WriteSkipped (ostream& ioOutStream, const char* iBench,
+	const SyntheticSpec& iSpec, const char* iReason)
+{
+	ioOutStream << "{\"bench\": \"" << iBench << "\""
+		<< ", \"version\": \"" << VERSION_HASH << "\", ";
+	WriteSpec (ioOutStream, iSpec);
+	ioOutStream << ", \"skipped\": \"" << iReason << "\"}" << endl;
+}
+
+
+// *** BENCHMARKS ********************************************************/
+#pragma mark --
+
+enum bench_t
+{
+	kBench_Parse,
+	kBench_Diversity,
+	kBench_Pairwise,
+	kBench_PorpCompat,
+	kBench_Theta,
+	kBench_Partitions,
+	kBench_PlotDiv,
+	kBench_Windows,
+	kBench_Jackknife,
+	kBench_Bootstrap
+};
+
+
+// TIME ONCE
+// Load a fresh model & time a single run of the benchmark on it.
+static double TimeOnce (bench_t iBench, const SyntheticSpec& iSpec,
+	const BenchSettings& iSettings, PhaseProfile& oProfile)
+{
+	QuietConsole		theQuiet;
+	MultiLocusModel	theModel;
+	benchClock_t::time_point	theStart;
+	double				theSeconds;
+
+	theModel.mEngine = iSettings.mEngine;
+	if (iSettings.mNumThreads)
+		theModel.mNumThreads = iSettings.mNumThreads;
+	theModel.mPairSampleError = iSettings.mPairSampleError;
+
+	if (iBench == kBench_Parse)
+	{
+		theStart = benchClock_t::now();
+		LoadModel (iSpec, theModel);
+		theSeconds = SecondsSince (theStart);
+		oProfile = theModel.GetProfile ();
+		return theSeconds;
+	}
+
+	LoadModel (iSpec, theModel);
+	ofstream theOutStrm (kScratchResultsPath);
+	if (not theOutStrm)
+		throw FileOpenError ("couldn't open scratch results", kScratchResultsPath);
+	ofstream theUnusedStrm;
+
+	theStart = benchClock_t::now();
+	switch (iBench)
+	{
+		case kBench_Diversity:
+			theModel.CalcDiversity (false, iSettings.mNumRandomizations, false,
+				theOutStrm, theUnusedStrm, theUnusedStrm);
+			break;
+
+		case kBench_Pairwise:
+			theModel.CalcDiversity (true, iSettings.mNumRandomizations, false,
+				theOutStrm, theOutStrm, theUnusedStrm);
+			break;
+
+		case kBench_PorpCompat:
+			for (UInt i = 0; i < iSettings.mNumRandomizations; i++)
+			{
+				double thePorpCompat;
+				theModel.CalcPorpCompat (thePorpCompat);
+			}
+			break;
+
+		case kBench_Theta:
+			theModel.CalcThetaLoop (theOutStrm, iSettings.mNumRandomizations);
+			break;
+
+		case kBench_Partitions:
+			theModel.FindPartsLoop (theOutStrm, iSettings.mNumPartRandomizations);
+			break;
+
+		case kBench_PlotDiv:
+			theModel.PlotDiv (iSettings.mNumPlotSamples, theOutStrm);
+			break;
+
+		case kBench_Windows:
+			theModel.CalcWindows (std::min (kWindowWidth, iSpec.mNumLoci), 1,
+				iSettings.mNumRandomizations, theOutStrm);
+			break;
+
+		case kBench_Jackknife:
+			theModel.CalcJackknife (theOutStrm);
+			break;
+
+		case kBench_Bootstrap:
+			theModel.CalcBootstrap (iSettings.mNumRandomizations, 0.95, theOutStrm);
+			break;
+
+		default:
+			assert (false);
+	}
+	theSeconds = SecondsSince (theStart);
+	oProfile = theModel.GetProfile ();
+	return theSeconds;
+}
+
+
+static void RunBench (ostream& ioOutStream, bench_t iBench, const char* iName,
+	const SyntheticSpec& iSpec, const BenchSettings& iSettings, UInt iNumUnits)
+{
+	if (not IsWanted (iSettings, iName))
+		return;
+
+	BenchResult theResult;
+	theResult.mBest = 0.0;
+	theResult.mTotal = 0.0;
+	theResult.mHasProfile = (iBench != kBench_Parse);
+	for (UInt i = 0; i < iSettings.mNumRepeats; i++)
+	{
+		PhaseProfile theProfile;
+		double theSeconds = TimeOnce (iBench, iSpec, iSettings, theProfile);
+		theResult.mTotal += theSeconds;
+		if ((i == 0) or (theSeconds < theResult.mBest))
+		{
+			theResult.mBest = theSeconds;
+			theResult.mBestProfile = theProfile;
+		}
+	}
+	WriteResult (ioOutStream, iName, iSpec, iSettings, iNumUnits, theResult);
+}
+
+
+// RUN BENCHMARKS
+// All those that make sense for the dataset: theta needs populations, &
+// partitions haploid data small enough to search.
+static void RunBenchmarks (ostream& ioOutStream, const SyntheticSpec& iSpec,
+	const BenchSettings& iSettings)
+{
+	WriteSyntheticData (iSpec, kScratchDataPath);
+
+	UInt theNumReps = iSettings.mNumRandomizations;
+	RunBench (ioOutStream, kBench_Parse, "parse", iSpec, iSettings, 1);
+	RunBench (ioOutStream, kBench_Diversity, "diversity", iSpec, iSettings,
+		theNumReps + 1);
+	RunBench (ioOutStream, kBench_Pairwise, "pairwise", iSpec, iSettings,
+		theNumReps + 1);
+	if (0 < theNumReps)
+		RunBench (ioOutStream, kBench_PorpCompat, "porp-compat", iSpec, iSettings,
+			theNumReps);
+
+	if (iSpec.mNumPops < 2)
+	{
+		if (IsWanted (iSettings, "theta"))
+			WriteSkipped (ioOutStream, "theta", iSpec, "needs 2 or more populations");
+	}
+	else
+		RunBench (ioOutStream, kBench_Theta, "theta", iSpec, iSettings,
+			theNumReps + 1);
+
+	if (iSpec.mPloidy != kPloidy_Haploid)
+	{
+		if (IsWanted (iSettings, "partitions"))
+			WriteSkipped (ioOutStream, "partitions", iSpec, "needs haploid data");
+	}
+	else if (kMaxPartIsolates < iSpec.mNumIsolates)
+	{
+		if (IsWanted (iSettings, "partitions"))
+			WriteSkipped (ioOutStream, "partitions", iSpec, "too many isolates");
+	}
+	else
+		RunBench (ioOutStream, kBench_Partitions, "partitions", iSpec, iSettings,
+			iSettings.mNumPartRandomizations + 1);
+
+	RunBench (ioOutStream, kBench_PlotDiv, "plot-div", iSpec, iSettings,
+		iSpec.mNumLoci);
+
+	if (iSpec.mNumLoci < 2)
+	{
+		if (IsWanted (iSettings, "windows"))
+			WriteSkipped (ioOutStream, "windows", iSpec, "needs 2 or more loci");
+	}
+	else
+		RunBench (ioOutStream, kBench_Windows, "windows", iSpec, iSettings,
+			theNumReps + 1);
+
+	if (iSpec.mNumLoci < 3)
+	{
+		if (IsWanted (iSettings, "jackknife"))
+			WriteSkipped (ioOutStream, "jackknife", iSpec, "needs 3 or more loci");
+	}
+	else
+		RunBench (ioOutStream, kBench_Jackknife, "jackknife", iSpec, iSettings,
+			iSpec.mNumLoci);
+	if (0 < theNumReps)
+		RunBench (ioOutStream, kBench_Bootstrap, "bootstrap", iSpec, iSettings,
+			theNumReps);
+
+	std::remove (kScratchDataPath);
+	std::remove (kScratchResultsPath);
+}
+
+
+// STANDARD SUITE
+// Small & large haploids, a diploid, and one small enough for partitions.
+static vector<SyntheticSpec> StandardSuite ()
+{
+	vector<SyntheticSpec>	theSuite;
+	SyntheticSpec				theSpec;
+
+	theSuite.push_back (theSpec);
+
+	theSpec.mPloidy = kPloidy_Diploid;
+	theSuite.push_back (theSpec);
+
+	theSpec.mPloidy = kPloidy_Haploid;
+	theSpec.mNumIsolates = 200;
+	theSpec.mNumLoci = 30;
+	theSpec.mNumAlleles = 6;
+	theSpec.mMissingRate = 0.05;
+	theSpec.mNumPops = 4;
+	theSpec.mNumLinkages = 6;
+	theSuite.push_back (theSpec);
+
+	theSpec.mNumIsolates = 12;
+	theSpec.mNumLoci = 10;
+	theSpec.mNumAlleles = 3;
+	theSpec.mMissingRate = 0.0;
+	theSpec.mNumPops = 2;
+	theSpec.mNumLinkages = 2;
+	theSuite.push_back (theSpec);
+
+	return theSuite;
+}
+
+
+// *** MAIN BODY *********************************************************/
+#pragma mark --
+
+static void PrintUsage ()
+{
+	cerr << "usage: multilocus-bench [generate <file>] [options]" << endl;
+	cerr << "dataset options (without any, a standard suite is run):" << endl;
+	cerr << "   --ploidy haploid|diploid  --isolates n  --loci n" << endl;
+	cerr << "   --alleles n  --missing rate  --pops n  --linkages n" << endl;
+	cerr << "   --profiles n (isolates copied from n genotypes)  --seed n" << endl;
+	cerr << "benchmark options:" << endl;
+	cerr << "   --reps n          randomizations for diversity & theta (20)" << endl;
+	cerr << "   --part-reps n     randomizations for partitions (5)" << endl;
+	cerr << "   --samples n       samples per size for plot-div (10)" << endl;
+	cerr << "   --repeats n       runs of each benchmark (3)" << endl;
+	cerr << "   --engine reference|fast  the statistics engine (fast)" << endl;
+	cerr << "   --threads n       threads for bootstrap (one per core)" << endl;
+	cerr << "   --pair-error x    estimate the variance of distances from sampled" << endl;
+	cerr << "                     pairs, to this relative standard error (every pair)" << endl;
+	cerr << "   --only a,b,...    parse, diversity, pairwise, porp-compat, theta," << endl;
+	cerr << "                     partitions, plot-div, windows, jackknife," << endl;
+	cerr << "                     bootstrap" << endl;
+	cerr << "   --out file        write results there, not to the console" << endl;
+	cerr << "or: multilocus-bench verify [options] [dataset files]" << endl;
+	cerr << "   --engine reference|fast  the engine to check (fast)" << endl;
+	cerr << "   --reps n          replicates as well as the observed data (5)" << endl;
+	cerr << "   --seed n          for the synthetic data & replicates (1)" << endl;
+	cerr << "   --tolerance x     largest difference allowed (1e-9)" << endl;
+	cerr << "   --golden file     check against values recorded earlier" << endl;
+	cerr << "   --record file     record the reference values" << endl;
+	cerr << "   --baseline file   also check against the original program's values" << endl;
+	cerr << "                     (" << kBaselineGoldenPath << "), none to skip" << endl;
+	cerr << "   --out file        write results there, not to the console" << endl;
+}
+
+
+static bool IsDatasetOption (const string& iName)
+{
+	const char* kDatasetOptions[] = {"--ploidy", "--isolates", "--loci",
+		"--alleles", "--missing", "--pops", "--linkages", "--profiles", "--seed"};
+	for (UInt i = 0; i < sizeof (kDatasetOptions) / sizeof (char*); i++)
+		if (iName == kDatasetOptions[i])
+			return true;
+	return false;
+}
+
+
+template <typename T>
+static T ReadOption (const string& iName, const char* iValue)
+{
+	T theValue;
+	istringstream theStrm (iValue);
+	if (not (theStrm >> theValue) or not theStrm.eof())
+		throw Error ((string ("bad value for ") + iName).c_str());
+	return theValue;
+}
+
+
+// VERIFY
+// The arguments after "verify": options, then any real datasets.
+static int Verify (int argc, char* argv[])
+{
+	CheckSettings	theSettings;
+	string			theOutPath;
+
+	theSettings.mEngine = kEngine_Fast;
+	theSettings.mNumReplicates = 5;
+	theSettings.mSeed = 1;
+	theSettings.mTolerance = 1e-9;
+	theSettings.mBaselinePath = kBaselineGoldenPath;
+
+	int theArgIndex = 0;
+	for (; theArgIndex < argc; theArgIndex += 2)
+	{
+		string theName = argv[theArgIndex];
+		if (theName.find ("--") != 0)
+			break;
+		if (argc <= theArgIndex + 1)
+			throw Error ((string ("no value for ") + theName).c_str());
+		const char* theValue = argv[theArgIndex + 1];
+
+		if (theName == "--engine")
+			theSettings.mEngine = ReadEngineName (theValue);
+		else if (theName == "--reps")
+			theSettings.mNumReplicates = ReadOption<UInt> (theName, theValue);
+		else if (theName == "--seed")
+			theSettings.mSeed = ReadOption<long> (theName, theValue);
+		else if (theName == "--tolerance")
+			theSettings.mTolerance = ReadOption<double> (theName, theValue);
+		else if (theName == "--golden")
+			theSettings.mGoldenPath = theValue;
+		else if (theName == "--record")
+			theSettings.mRecordPath = theValue;
+		else if (theName == "--baseline")
+			theSettings.mBaselinePath = (string (theValue) == "none") ? "" : theValue;
+		else if (theName == "--out")
+			theOutPath = theValue;
+		else
+			throw Error ((string ("unknown option ") + theName).c_str());
+	}
+	for (; theArgIndex < argc; theArgIndex++)
+		theSettings.mFixturePaths.push_back (argv[theArgIndex]);
+
+	ofstream theOutFile;
+	if (not theOutPath.empty())
+	{
+		theOutFile.open (theOutPath.c_str());
+		if (not theOutFile)
+			throw FileOpenError ("couldn't open results file", theOutPath.c_str());
+	}
+	ostream& theOutStrm = theOutPath.empty() ? cout : theOutFile;
+
+	if (RunKernelChecks (theOutStrm, theSettings))
+		return 0;
+	cerr << "multilocus-bench: kernels differ from the reference" << endl;
+	return 1;
+}
+
+
+int main (int argc, char* argv[])
+{
+	SyntheticSpec	theSpec;
+	bool				theSpecGiven = false;
+	BenchSettings	theSettings;
+	string			theGeneratePath;
+	string			theOutPath;
+
+	theSettings.mEngine = kEngine_Fast;
+	theSettings.mNumRandomizations = 20;
+	theSettings.mNumPartRandomizations = 5;
+	theSettings.mNumPlotSamples = 10;
+	theSettings.mNumRepeats = 3;
+	theSettings.mNumThreads = 0;
+	theSettings.mPairSampleError = 0.0;
+
+	try
+	{
+		if ((1 < argc) and (string (argv[1]) == "verify"))
+			return Verify (argc - 2, argv + 2);
+
+		int theArgIndex = 1;
+		if ((1 < argc) and (string (argv[1]) == "generate"))
+		{
+			if (argc < 3)
+				throw Error ("no file given to generate");
+			theGeneratePath = argv[2];
+			theArgIndex = 3;
+		}
+		for (; theArgIndex < argc; theArgIndex += 2)
+		{
+			string theName = argv[theArgIndex];
+			if ((theName == "--help") or (theName == "-h"))
+			{
+				PrintUsage ();
+				return 0;
+			}
+			if (argc <= theArgIndex + 1)
+				throw Error ((string ("no value for ") + theName).c_str());
+			const char* theValue = argv[theArgIndex + 1];
+
+			if (theName == "--ploidy")
+			{
+				string thePloidy = theValue;
+				if (thePloidy == "haploid")
+					theSpec.mPloidy = kPloidy_Haploid;
+				else if (thePloidy == "diploid")
+					theSpec.mPloidy = kPloidy_Diploid;
+				else
+					throw Error ("ploidy must be haploid or diploid");
+			}
+			else if (theName == "--isolates")
+				theSpec.mNumIsolates = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--loci")
+				theSpec.mNumLoci = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--alleles")
+				theSpec.mNumAlleles = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--missing")
+				theSpec.mMissingRate = ReadOption<double> (theName, theValue);
+			else if (theName == "--pops")
+				theSpec.mNumPops = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--linkages")
+				theSpec.mNumLinkages = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--profiles")
+				theSpec.mNumProfiles = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--seed")
+				theSpec.mSeed = ReadOption<long> (theName, theValue);
+			else if (theName == "--reps")
+				theSettings.mNumRandomizations = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--part-reps")
+				theSettings.mNumPartRandomizations = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--samples")
+				theSettings.mNumPlotSamples = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--repeats")
+				theSettings.mNumRepeats = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--engine")
+				theSettings.mEngine = ReadEngineName (theValue);
+			else if (theName == "--threads")
+				theSettings.mNumThreads = ReadOption<UInt> (theName, theValue);
+			else if (theName == "--pair-error")
+				theSettings.mPairSampleError = ReadOption<double> (theName, theValue);
+			else if (theName == "--only")
+				theSettings.mOnly = theValue;
+			else if (theName == "--out")
+				theOutPath = theValue;
+			else
+				throw Error ((string ("unknown option ") + theName).c_str());
+
+			if (IsDatasetOption (theName))
+				theSpecGiven = true;
+		}
+		if (theSettings.mNumRepeats < 1)
+			throw Error ("there must be at least 1 repeat");
+
+		if (not theGeneratePath.empty())
+		{
+			WriteSyntheticData (theSpec, theGeneratePath.c_str());
+			return 0;
+		}
+
+		ofstream theOutFile;
+		if (not theOutPath.empty())
+		{
+			theOutFile.open (theOutPath.c_str());
+			if (not theOutFile)
+				throw FileOpenError ("couldn't open results file", theOutPath.c_str());
+		}
+		ostream& theOutStrm = theOutPath.empty() ? cout : theOutFile;
+
+		vector<SyntheticSpec> theSpecs;
+		if (theSpecGiven)
+			theSpecs.push_back (theSpec);
+		else
+			theSpecs = StandardSuite ();
+		for (UInt i = 0; i < theSpecs.size(); i++)
+		{
+			CheckSyntheticSpec (theSpecs[i]);
+			RunBenchmarks (theOutStrm, theSpecs[i], theSettings);
+		}
+	}
+	catch (Error& theError)
+	{
+		cerr << "multilocus-bench: " << theError.what() << endl;
+		PrintUsage ();
+		return 1;
+	}
+	catch (std::exception& theError)
+	{
+		cerr << "multilocus-bench: " << theError.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+// *** END ***************************************************************/
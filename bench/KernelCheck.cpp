@@ -0,0 +1,540 @@
+/**************************************************************************
+KernelCheck.cpp - checking alternative statistics engines against the reference
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header. Replicates are made just as the randomization loops make
+  them (reseeded from the run seed & shuffled within populations) so the
+  same seed gives the same replicates under every engine.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "KernelCheck.h"
+#include "QuietConsole.h"
+#include "Error.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+using std::ostringstream;
+using std::endl;
+using std::setprecision;
+using sbl::Error;
+using sbl::FormatError;
+using sbl::FileOpenError;
+using sbl::FileWriteError;
+
+
+// *** CONSTANTS & DEFINES
+
+// searching for partitions is exponential in the number of isolates
+const UInt	kMaxCheckPartIsolates	= 14;
+
+// in a scratch directory of their own, see ScratchDir
+const char*	kCheckDataName				= "verify.txt";
+const char*	kCheckScratchName			= "verify.out";
+
+// a dataset to be checked, either synthetic or read from a file
+struct CheckDataset
+{
+	string			mName;
+	bool				mIsSynthetic;
+	SyntheticSpec	mSpec;
+	string			mPath;
+};
+
+
+// SCRATCH DIRECTORY
+// The synthetic datasets & the results the kernels insist on writing go in
+// a directory made for them under the system's temporary one. It's removed
+// with its contents when the checks finish, however they finish.
+class ScratchDir
+{
+public:
+	ScratchDir ()
+	{
+		const char* theTmpDir = std::getenv ("TMPDIR");
+		string theTemplate = string ((theTmpDir == NULL) ? "/tmp" : theTmpDir) +
+			"/multilocus-verify-XXXXXX";
+		vector<char> theBuffer (theTemplate.begin(), theTemplate.end());
+		theBuffer.push_back ('\0');
+		if (mkdtemp (&theBuffer[0]) == NULL)
+			throw FileOpenError ("couldn't make scratch directory",
+				theTemplate.c_str());
+		mDirPath = &theBuffer[0];
+	}
+
+	~ScratchDir ()
+	{
+		std::remove (GetPath (kCheckDataName).c_str());
+		std::remove (GetPath (kCheckScratchName).c_str());
+		rmdir (mDirPath.c_str());
+	}
+
+	string	GetPath (const char* iName) const
+		{ return mDirPath + "/" + iName; }
+
+private:
+	string	mDirPath;
+};
+
+
+// *** LOCAL FUNCTIONS ***************************************************/
+
+static void AddValue (kernelValues_t& ioValues, const char* iKernel,
+	double iValue)
+{
+	ioValues[iKernel].push_back (iValue);
+}
+
+
+// CHECK SUITE
+// Small enough to run in seconds, but covering both ploidies, missing
+// data, several populations & linkage groups, a partition search, and
+// isolates sharing genotypes.
+static vector<CheckDataset> CheckSuite (long iSeed)
+{
+	vector<CheckDataset>	theSuite;
+	CheckDataset			theDataset;
+	SyntheticSpec&			theSpec = theDataset.mSpec;
+
+	theDataset.mIsSynthetic = true;
+	theSpec.mSeed = iSeed;
+
+	theDataset.mName = "haploid-small";
+	theSpec.mPloidy = kPloidy_Haploid;
+	theSpec.mNumIsolates = 12;
+	theSpec.mNumLoci = 8;
+	theSpec.mNumAlleles = 3;
+	theSpec.mMissingRate = 0.0;
+	theSpec.mNumPops = 2;
+	theSpec.mNumLinkages = 2;
+	theSuite.push_back (theDataset);
+
+	theDataset.mName = "haploid-missing";
+	theSpec.mNumIsolates = 40;
+	theSpec.mNumLoci = 12;
+	theSpec.mNumAlleles = 5;
+	theSpec.mMissingRate = 0.05;
+	theSpec.mNumPops = 3;
+	theSpec.mNumLinkages = 3;
+	theSuite.push_back (theDataset);
+
+	theDataset.mName = "diploid-missing";
+	theSpec.mPloidy = kPloidy_Diploid;
+	theSpec.mNumIsolates = 30;
+	theSpec.mNumLoci = 10;
+	theSpec.mNumAlleles = 4;
+	theSpec.mNumPops = 2;
+	theSpec.mNumLinkages = 5;
+	theSuite.push_back (theDataset);
+
+	theDataset.mName = "diploid-clonal";
+	theSpec.mNumIsolates = 40;
+	theSpec.mNumProfiles = 8;
+	theSuite.push_back (theDataset);
+
+	theDataset.mName = "haploid-clonal";
+	theSpec.mPloidy = kPloidy_Haploid;
+	theSpec.mNumLoci = 7;
+	theSpec.mNumProfiles = 6;
+	theSuite.push_back (theDataset);
+
+	return theSuite;
+}
+
+
+// LOAD CHECK MODEL
+// A real dataset is given two populations, if it's big enough, so that
+// theta has something to work on.
+static void LoadCheckModel (const CheckDataset& iDataset, engine_t iEngine,
+	long iSeed, const ScratchDir& iScratch, MultiLocusModel& ioModel)
+{
+	string thePathStr = iDataset.mIsSynthetic ?
+		iScratch.GetPath (kCheckDataName) : iDataset.mPath;
+	const char* thePath = thePathStr.c_str();
+	ifstream theInStrm (thePath);
+	if (not theInStrm)
+		throw FileOpenError ("couldn't open dataset", thePath);
+	ioModel.ParseInput (theInStrm, thePath);
+
+	if (iDataset.mIsSynthetic)
+		SetSyntheticParts (iDataset.mSpec, ioModel);
+	else if (4 <= ioModel.GetNumRows())
+	{
+		vector<int> thePopSizes = SplitEvenly (ioModel.GetNumRows(), 2);
+		ioModel.mPops.SetParts (thePopSizes);
+	}
+	ioModel.mEngine = iEngine;
+	ioModel.SetRunSeed (iSeed);
+}
+
+
+static void CollectDataset (const CheckDataset& iDataset, engine_t iEngine,
+	const CheckSettings& iSettings, const ScratchDir& iScratch,
+	kernelValues_t& oValues)
+{
+	QuietConsole		theQuiet;
+	MultiLocusModel	theModel;
+	LoadCheckModel (iDataset, iEngine, iSettings.mSeed, iScratch, theModel);
+	CollectKernelValues (theModel, iSettings.mNumReplicates,
+		iScratch.GetPath (kCheckScratchName).c_str(), oValues);
+}
+
+
+static void WriteCheck (ostream& ioOutStream, const string& iKernel,
+	const string& iDataset, const CheckSettings& iSettings,
+	const char* iAgainst, UInt iNumValues, double iDifference, bool iIsOk)
+{
+	ioOutStream << "{\"check\": \"" << iKernel << "\""
+		<< ", \"dataset\": \"" << iDataset << "\""
+		<< ", \"engine\": \"" << GetEngineName (iSettings.mEngine) << "\""
+		<< ", \"against\": \"" << iAgainst << "\""
+		<< ", \"values\": " << iNumValues
+		<< ", \"max_abs_diff\": " << iDifference
+		<< ", \"ok\": " << (iIsOk ? "true" : "false") << "}" << endl;
+}
+
+
+// *** MAIN BODY *********************************************************/
+
+// GET ENGINE NAME & READ ENGINE NAME
+// As used in the options & results of the benchmarks & checks.
+const char* GetEngineName (engine_t iEngine)
+{
+	return (iEngine == kEngine_Reference) ? "reference" : "fast";
+}
+
+
+engine_t ReadEngineName (const char* iName)
+{
+	string theName = iName;
+	if (theName == "reference")
+		return kEngine_Reference;
+	if (theName != "fast")
+		throw Error ("engine must be reference or fast");
+	return kEngine_Fast;
+}
+
+
+// COLLECT KERNEL VALUES
+// The observed data is done first, then each replicate. Variances of
+// distances are taken from the observed data, as for CalcDiversity().
+// Pairwise r values are collected for replicates as well, by treating
+// each as if it were observed.
+void CollectKernelValues (MultiLocusModel& ioModel, UInt iNumReplicates,
+	const char* iScratchPath, kernelValues_t& oValues)
+{
+	ofstream theScratchStrm (iScratchPath);
+	if (not theScratchStrm)
+		throw FileOpenError ("couldn't open scratch results", iScratchPath);
+
+	oValues.clear ();
+	ioModel.CalcVarDistances ();
+	bool theIsRankable = ioModel.IsDataRankable ();
+	if (theIsRankable)
+		ioModel.PrepRBarSCalc ();
+	bool theDoTheta = (1 < ioModel.mPops.GetNumParts());
+	bool theDoParts = (ioModel.GetPloidy() == kPloidy_Haploid) and
+		(ioModel.GetNumRows() <= kMaxCheckPartIsolates);
+
+	// bootstrap replicates are of the observed data only
+	MATRIX(double) theBootStats;
+	ioModel.CalcBootstrapStats (iNumReplicates + 1, theBootStats);
+	for (UInt i = 0; i < theBootStats.size(); i++)
+	{
+		for (UInt k = 0; k < theBootStats[i].size(); k++)
+			AddValue (oValues, "bootstrap", theBootStats[i][k]);
+	}
+
+	ioModel.BackupWorkingData ();
+	for (UInt i = 0; i <= iNumReplicates; i++)
+	{
+		if (i != 0)
+		{
+			ioModel.SeedReplicate (i);
+			ioModel.ShuffleDataset ();
+		}
+
+		double	theDiversity;
+		int		theNumDiff, theMaxFreq;
+		ioModel.CalcNumDiff (theDiversity, theNumDiff, theMaxFreq);
+		AddValue (oValues, "num-diff", theNumDiff);
+		AddValue (oValues, "num-diff", theMaxFreq);
+		AddValue (oValues, "num-diff", theDiversity);
+
+		double thePorpCompat;
+		ioModel.CalcPorpCompat (thePorpCompat);
+		AddValue (oValues, "porp-compat", thePorpCompat);
+
+		double theIndexAssoc, theRBarD;
+		ioModel.CalcIndexAssocRBarD (theIndexAssoc, theRBarD);
+		AddValue (oValues, "index-assoc", theIndexAssoc);
+		AddValue (oValues, "index-assoc", theRBarD);
+
+		if (theIsRankable)
+		{
+			double theRBarS;
+			ioModel.CalcRBarS (theRBarS);
+			AddValue (oValues, "rbars", theRBarS);
+		}
+
+		// overlapping windows, then windows too far apart to overlap
+		vector<double> theWindowIa, theWindowRBarD;
+		UInt theNumLoci = ioModel.GetNumCols();
+		ioModel.CalcWindowStats ((theNumLoci + 1) / 2, 1, theWindowIa,
+			theWindowRBarD);
+		for (UInt j = 0; j < theWindowIa.size(); j++)
+		{
+			AddValue (oValues, "windows", theWindowIa[j]);
+			AddValue (oValues, "windows", theWindowRBarD[j]);
+		}
+		ioModel.CalcWindowStats (2, 3, theWindowIa, theWindowRBarD);
+		for (UInt j = 0; j < theWindowIa.size(); j++)
+		{
+			AddValue (oValues, "windows", theWindowIa[j]);
+			AddValue (oValues, "windows", theWindowRBarD[j]);
+		}
+
+		vector<double> theJackIa, theJackRBarD;
+		ioModel.CalcJackknifeStats (theJackIa, theJackRBarD);
+		for (UInt j = 0; j < theJackIa.size(); j++)
+		{
+			AddValue (oValues, "jackknife", theJackIa[j]);
+			AddValue (oValues, "jackknife", theJackRBarD[j]);
+		}
+
+		vector<double> thePairwiseR (ioModel.mNumPairsSites, 0.0);
+		vector<double> thePairPVals (ioModel.mNumPairsSites, 0.0);
+		ioModel.CalcPairwiseStats (theScratchStrm, thePairwiseR, thePairPVals,
+			true);
+		for (UInt j = 0; j < thePairwiseR.size(); j++)
+			AddValue (oValues, "pairwise", thePairwiseR[j]);
+
+		if (theDoTheta)
+		{
+			double theTheta;
+			ioModel.CalcTheta (theTheta);
+			AddValue (oValues, "theta", theTheta);
+		}
+
+		if (theDoParts)
+			AddValue (oValues, "partitions", ioModel.FindParts (theScratchStrm, i));
+
+		if (i != 0)
+			ioModel.RestoreWorkingData ();
+	}
+
+	theScratchStrm.close ();
+	std::remove (iScratchPath);
+}
+
+
+// MAX ABS DIFFERENCE
+// Values that are both NaN (e.g. from a locus with no variation) agree. A
+// different number of values can't be compared at all.
+double MaxAbsDifference
+(const vector<double>& iExpected, const vector<double>& iActual)
+{
+	const double kInfinity = std::numeric_limits<double>::infinity();
+	if (iExpected.size() != iActual.size())
+		return kInfinity;
+
+	double theMaxDiff = 0.0;
+	for (UInt i = 0; i < iExpected.size(); i++)
+	{
+		bool theExpIsNan = std::isnan (iExpected[i]);
+		bool theActIsNan = std::isnan (iActual[i]);
+		if (theExpIsNan or theActIsNan)
+		{
+			if (theExpIsNan != theActIsNan)
+				return kInfinity;
+			continue;
+		}
+		if (iExpected[i] == iActual[i])
+			continue;
+		double theDiff = std::fabs (iExpected[i] - iActual[i]);
+		if (theMaxDiff < theDiff)
+			theMaxDiff = theDiff;
+	}
+	return theMaxDiff;
+}
+
+
+// WRITE GOLDEN VALUES
+// A line naming each dataset (& the seed used), then a line for each of
+// its kernels with the number of values & the values, at full precision.
+void WriteGoldenValues (const char* iPath, const datasetValues_t& iValues)
+{
+	ofstream theOutStrm (iPath);
+	if (not theOutStrm)
+		throw FileOpenError ("couldn't open golden values", iPath);
+	theOutStrm << setprecision (17);
+
+	datasetValues_t::const_iterator p;
+	for (p = iValues.begin(); p != iValues.end(); p++)
+	{
+		theOutStrm << "dataset\t" << p->first << endl;
+		kernelValues_t::const_iterator q;
+		for (q = p->second.begin(); q != p->second.end(); q++)
+		{
+			theOutStrm << q->first << "\t" << q->second.size();
+			for (UInt i = 0; i < q->second.size(); i++)
+				theOutStrm << "\t" << q->second[i];
+			theOutStrm << endl;
+		}
+	}
+
+	theOutStrm.close ();
+	if (not theOutStrm)
+		throw FileWriteError ("couldn't write golden values", iPath);
+}
+
+
+// READ GOLDEN VALUES
+// Values are read with strtod(), so that "nan" & "inf" come back as
+// written.
+void ReadGoldenValues (const char* iPath, datasetValues_t& oValues)
+{
+	ifstream theInStrm (iPath);
+	if (not theInStrm)
+		throw FileOpenError ("couldn't open golden values", iPath);
+
+	oValues.clear ();
+	kernelValues_t*	theDataset = NULL;
+	string				theLine;
+	while (std::getline (theInStrm, theLine))
+	{
+		if (theLine.empty())
+			continue;
+		istringstream theLineStrm (theLine);
+		string theKey, theToken;
+		std::getline (theLineStrm, theKey, '\t');
+		if (theKey == "dataset")
+		{
+			std::getline (theLineStrm, theToken);
+			theDataset = &oValues[theToken];
+			continue;
+		}
+		if (theDataset == NULL)
+			throw FormatError ("golden values must start with a dataset");
+
+		UInt theNumValues;
+		if (not (theLineStrm >> theNumValues))
+			throw FormatError ("badly formed golden values");
+		vector<double>& theValues = (*theDataset)[theKey];
+		while (theLineStrm >> theToken)
+			theValues.push_back (std::strtod (theToken.c_str(), NULL));
+		if (theValues.size() != theNumValues)
+			throw FormatError ("wrong number of golden values");
+	}
+}
+
+
+// RUN KERNEL CHECKS
+// Returns whether every kernel on every dataset was within tolerance. The
+// baseline values only cover the kernels the original program had, & only
+// the synthetic suite, so just those are checked against them.
+bool RunKernelChecks (ostream& ioOutStream, const CheckSettings& iSettings)
+{
+	datasetValues_t theGolden, theRecorded, theBaseline;
+	bool theUseGolden = not iSettings.mGoldenPath.empty();
+	bool theDoRecord = not iSettings.mRecordPath.empty();
+	if (theUseGolden)
+		ReadGoldenValues (iSettings.mGoldenPath.c_str(), theGolden);
+	if (not iSettings.mBaselinePath.empty())
+		ReadGoldenValues (iSettings.mBaselinePath.c_str(), theBaseline);
+
+	vector<CheckDataset> theDatasets = CheckSuite (iSettings.mSeed);
+	for (UInt i = 0; i < iSettings.mFixturePaths.size(); i++)
+	{
+		CheckDataset theDataset;
+		theDataset.mName = iSettings.mFixturePaths[i];
+		theDataset.mIsSynthetic = false;
+		theDataset.mPath = iSettings.mFixturePaths[i];
+		theDatasets.push_back (theDataset);
+	}
+
+	ScratchDir theScratch;
+	bool theAllOk = true;
+	for (UInt i = 0; i < theDatasets.size(); i++)
+	{
+		const CheckDataset& theDataset = theDatasets[i];
+		if (theDataset.mIsSynthetic)
+			WriteSyntheticData (theDataset.mSpec,
+				theScratch.GetPath (kCheckDataName).c_str());
+
+		// the values depend on the seed & replicates, so they're part of the
+		// golden name
+		ostringstream theGoldenName;
+		theGoldenName << theDataset.mName << "\t" << iSettings.mSeed << "\t"
+			<< iSettings.mNumReplicates;
+
+		kernelValues_t theExpected, theActual;
+		if (theDoRecord or not theUseGolden)
+			CollectDataset (theDataset, kEngine_Reference, iSettings, theScratch,
+				theExpected);
+		if (theDoRecord)
+			theRecorded[theGoldenName.str()] = theExpected;
+		if (theUseGolden)
+		{
+			datasetValues_t::iterator p = theGolden.find (theGoldenName.str());
+			if (p == theGolden.end())
+				throw Error ((string ("no golden values for ") + theDataset.mName +
+					" with this seed & number of replicates").c_str());
+			theExpected = p->second;
+		}
+		CollectDataset (theDataset, iSettings.mEngine, iSettings, theScratch,
+			theActual);
+
+		// every kernel found by either
+		const char* theAgainst = theUseGolden ? "golden" : "reference";
+		kernelValues_t theKernels = theExpected;
+		theKernels.insert (theActual.begin(), theActual.end());
+		kernelValues_t::iterator q;
+		for (q = theKernels.begin(); q != theKernels.end(); q++)
+		{
+			double theDiff = MaxAbsDifference (theExpected[q->first],
+				theActual[q->first]);
+			bool theIsOk = (theDiff <= iSettings.mTolerance);
+			WriteCheck (ioOutStream, q->first, theDataset.mName, iSettings,
+				theAgainst, theActual[q->first].size(), theDiff, theIsOk);
+			theAllOk = theAllOk and theIsOk;
+		}
+
+		datasetValues_t::iterator b = theBaseline.find (theGoldenName.str());
+		if (b != theBaseline.end())
+		{
+			for (q = b->second.begin(); q != b->second.end(); q++)
+			{
+				double theDiff = MaxAbsDifference (q->second, theActual[q->first]);
+				bool theIsOk = (theDiff <= iSettings.mTolerance);
+				WriteCheck (ioOutStream, q->first, theDataset.mName, iSettings,
+					"baseline", theActual[q->first].size(), theDiff, theIsOk);
+				theAllOk = theAllOk and theIsOk;
+			}
+		}
+	}
+
+	if (theDoRecord)
+		WriteGoldenValues (iSettings.mRecordPath.c_str(), theRecorded);
+	return theAllOk;
+}
+
+
+// *** END ***************************************************************/
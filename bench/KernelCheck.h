@@ -0,0 +1,86 @@
+/**************************************************************************
+KernelCheck.h - checking alternative statistics engines against the reference
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- Before a faster implementation of the statistics is used, it has to be
+  shown to give today's numbers. The kernels (number of genotypes &
+  diversity, compatibility, index of association & rBarD, rBarS, the
+  pairwise r values, theta & the partitions found) are run under each
+  engine on the observed data & on a few seeded replicates, and the
+  largest absolute difference for each kernel is reported.
+- The values from the reference engine can also be recorded to a "golden"
+  file & later engines (or later versions) checked against that, for when
+  the reference itself has to change underneath, e.g. the storage of the
+  data.
+- The values the original program gave for the synthetic suite, for the
+  kernels it had, are kept in bench/baseline.golden. By default every
+  check is also made against them, so the reference engine can't drift
+  from the original unnoticed.
+- Run as "multilocus-bench verify", see Bench.cpp.
+
+**************************************************************************/
+
+#ifndef KERNELCHECK_H
+#define KERNELCHECK_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "MultiLocusModel.h"
+#include "SyntheticData.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+
+using std::vector;
+using std::string;
+using std::map;
+using std::ostream;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+// the values from each kernel, in the order calculated
+typedef map< string, vector<double> >		kernelValues_t;
+// & for each dataset, by name
+typedef map< string, kernelValues_t >		datasetValues_t;
+
+struct CheckSettings
+{
+	engine_t	mEngine;					// the engine to be checked
+	UInt		mNumReplicates;
+	long		mSeed;
+	double	mTolerance;				// largest difference allowed
+	string	mGoldenPath;			// check against this, not the reference
+	string	mRecordPath;			// save the reference values here
+	string	mBaselinePath;			// & check against these, if not empty
+	vector<string>	mFixturePaths;	// real datasets, as well as synthetic
+};
+
+
+// *** FUNCTION DECLARATIONS *********************************************/
+
+const char*	GetEngineName	(engine_t iEngine);
+engine_t	ReadEngineName			(const char* iName);
+void		CollectKernelValues	(MultiLocusModel& ioModel, UInt iNumReplicates,
+											const char* iScratchPath,
+											kernelValues_t& oValues);
+double	MaxAbsDifference		(const vector<double>& iExpected,
+											const vector<double>& iActual);
+void		WriteGoldenValues		(const char* iPath,
+											const datasetValues_t& iValues);
+void		ReadGoldenValues		(const char* iPath, datasetValues_t& oValues);
+bool		RunKernelChecks		(ostream& ioOutStream,
+											const CheckSettings& iSettings);
+
+
+#endif
+// *** END ***************************************************************/
@@ -0,0 +1,45 @@
+/**************************************************************************
+QuietConsole.h - silencing the console while the model is at work
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- Parsing & the analyses still write the odd message to the console, which
+  mustn't get mixed up with the results of the benchmarks & checks. While
+  one of these is in scope, anything written to cout is dropped.
+
+**************************************************************************/
+
+#ifndef QUIETCONSOLE_H
+#define QUIETCONSOLE_H
+
+
+// *** INCLUDES
+
+#include <iostream>
+
+
+// *** CLASS DECLARATION *************************************************/
+
+class QuietConsole
+{
+public:
+	QuietConsole ()
+		: mOldBuf (std::cout.rdbuf (NULL))
+		{}
+
+	~QuietConsole ()
+	{
+		std::cout.rdbuf (mOldBuf);
+		std::cout.clear ();
+	}
+
+private:
+	std::streambuf*	mOldBuf;
+};
+
+
+#endif
+// *** END ***************************************************************/
@@ -0,0 +1,214 @@
+/**************************************************************************
+SyntheticData.cpp - generating datasets of a given shape for benchmarking
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- See header.
+
+Changes:
+- Isolates can be copied from a few profiles.
+
+**************************************************************************/
+
+
+// *** INCLUDES
+
+#include "SyntheticData.h"
+#include "RandomService.h"
+#include "Error.h"
+
+#include <fstream>
+
+using std::ofstream;
+using std::endl;
+using sbl::Error;
+using sbl::FileOpenError;
+using sbl::FileWriteError;
+
+
+// *** CONSTANTS & DEFINES
+
+// the founder haplotypes of each population & linkage group
+const UInt		kNumFounders		= 4;
+// chance of an allele being copied from the founder, rather than drawn
+const double	kFounderFidelity	= 0.7;
+
+
+// *** LOCAL FUNCTIONS ***************************************************/
+
+// DRAW ALLELE
+// Choose an allele (counting from 0) by the given relative frequencies.
+static UInt DrawAllele (RandomService& ioRng, const vector<double>& iFreqs)
+{
+	double theTotal = 0.0;
+	for (UInt i = 0; i < iFreqs.size(); i++)
+		theTotal += iFreqs[i];
+	double theDraw = ioRng.UniformFloat (theTotal);
+	for (UInt i = 0; i < iFreqs.size(); i++)
+	{
+		if (theDraw < iFreqs[i])
+			return i;
+		theDraw -= iFreqs[i];
+	}
+	return iFreqs.size() - 1;
+}
+
+
+// *** MAIN BODY *********************************************************/
+
+// CHECK SYNTHETIC SPEC
+// Every population & linkage group must get at least one member.
+void CheckSyntheticSpec (const SyntheticSpec& iSpec)
+{
+	if ((iSpec.mPloidy != kPloidy_Haploid) and
+		(iSpec.mPloidy != kPloidy_Diploid))
+		throw Error ("synthetic data must be haploid or diploid");
+	if (iSpec.mNumIsolates < 2)
+		throw Error ("synthetic data needs at least 2 isolates");
+	if (iSpec.mNumLoci < 2)
+		throw Error ("synthetic data needs at least 2 loci");
+	if (iSpec.mNumAlleles < 1)
+		throw Error ("synthetic data needs at least 1 allele per locus");
+	if ((iSpec.mMissingRate < 0.0) or (1.0 <= iSpec.mMissingRate))
+		throw Error ("the missing rate must be at least 0 & less than 1");
+	if ((iSpec.mNumPops < 1) or (iSpec.mNumIsolates < iSpec.mNumPops))
+		throw Error ("there must be between 1 population & 1 per isolate");
+	if ((iSpec.mNumLinkages < 1) or (iSpec.mNumLoci < iSpec.mNumLinkages))
+		throw Error ("there must be between 1 linkage group & 1 per locus");
+	if (iSpec.mNumIsolates < iSpec.mNumProfiles)
+		throw Error ("there can't be more profiles than isolates");
+}
+
+
+// SPLIT EVENLY
+// The sizes of parts as near equal as possible, the larger first.
+vector<int> SplitEvenly (UInt iNumElements, UInt iNumParts)
+{
+	assert ((0 < iNumParts) and (iNumParts <= iNumElements));
+	vector<int> theSizes;
+	for (UInt i = 0; i < iNumParts; i++)
+		theSizes.push_back ((iNumElements * (i + 1) / iNumParts) -
+			(iNumElements * i / iNumParts));
+	return theSizes;
+}
+
+
+// WRITE SYNTHETIC DATA
+// The data is built a population & a linkage group at a time: draw allele
+// frequencies & founders for the pair, then the isolates from these.
+void WriteSyntheticData (const SyntheticSpec& iSpec, ostream& ioOutStream)
+{
+	CheckSyntheticSpec (iSpec);
+	RandomService theRng (iSpec.mSeed);
+
+	UInt theNumHaplos = (iSpec.mPloidy == kPloidy_Diploid) ? 2 : 1;
+	vector<int> thePopSizes = SplitEvenly (iSpec.mNumIsolates, iSpec.mNumPops);
+	vector<int> theLinkSizes = SplitEvenly (iSpec.mNumLoci, iSpec.mNumLinkages);
+
+	// theData[isolate][locus][haplotype], alleles counting from 0
+	vector< vector< vector<UInt> > >	theData (iSpec.mNumIsolates,
+		vector< vector<UInt> > (iSpec.mNumLoci, vector<UInt> (theNumHaplos, 0)));
+
+	UInt theFirstIso = 0;
+	for (UInt p = 0; p < thePopSizes.size(); p++)
+	{
+		UInt theFirstLocus = 0;
+		for (UInt g = 0; g < theLinkSizes.size(); g++)
+		{
+			// skewed frequencies, so populations differ
+			MATRIX(double) theFreqs (theLinkSizes[g],
+				vector<double> (iSpec.mNumAlleles, 0.0));
+			for (int j = 0; j < theLinkSizes[g]; j++)
+				for (UInt a = 0; a < iSpec.mNumAlleles; a++)
+				{
+					double theDraw = theRng.UniformFloat ();
+					theFreqs[j][a] = theDraw * theDraw + 0.01;
+				}
+
+			MATRIX(UInt) theFounders (kNumFounders,
+				vector<UInt> (theLinkSizes[g], 0));
+			for (UInt f = 0; f < kNumFounders; f++)
+				for (int j = 0; j < theLinkSizes[g]; j++)
+					theFounders[f][j] = DrawAllele (theRng, theFreqs[j]);
+
+			for (int i = 0; i < thePopSizes[p]; i++)
+			{
+				for (UInt h = 0; h < theNumHaplos; h++)
+				{
+					UInt theFounder = theRng.UniformWhole (kNumFounders);
+					for (int j = 0; j < theLinkSizes[g]; j++)
+					{
+						UInt& theAllele = theData[theFirstIso + i][theFirstLocus + j][h];
+						if (theRng.UniformFloat () < kFounderFidelity)
+							theAllele = theFounders[theFounder][j];
+						else
+							theAllele = DrawAllele (theRng, theFreqs[j]);
+					}
+				}
+			}
+			theFirstLocus += theLinkSizes[g];
+		}
+		theFirstIso += thePopSizes[p];
+	}
+
+	// every isolate past the profiles is a copy of one of them
+	if (iSpec.mNumProfiles)
+	{
+		for (UInt i = iSpec.mNumProfiles; i < iSpec.mNumIsolates; i++)
+			theData[i] = theData[theRng.UniformWhole (iSpec.mNumProfiles)];
+	}
+
+	// write it out, dropping alleles as we go
+	for (UInt i = 0; i < iSpec.mNumIsolates; i++)
+	{
+		for (UInt j = 0; j < iSpec.mNumLoci; j++)
+		{
+			if (j != 0)
+				ioOutStream << "\t";
+			bool theIsMissing = (theRng.UniformFloat () < iSpec.mMissingRate);
+			for (UInt h = 0; h < theNumHaplos; h++)
+			{
+				if (h != 0)
+					ioOutStream << "/";
+				if (theIsMissing)
+					ioOutStream << "?";
+				else
+					ioOutStream << (theData[i][j][h] + 1);
+			}
+		}
+		ioOutStream << endl;
+	}
+}
+
+
+void WriteSyntheticData (const SyntheticSpec& iSpec, const char* iPath)
+{
+	ofstream theOutStrm (iPath);
+	if (not theOutStrm)
+		throw FileOpenError ("couldn't open synthetic data file", iPath);
+	WriteSyntheticData (iSpec, theOutStrm);
+	theOutStrm.close();
+	if (not theOutStrm)
+		throw FileWriteError ("couldn't write synthetic data file", iPath);
+}
+
+
+// SET SYNTHETIC PARTS
+// Give a model that has read the synthetic data the populations & linkage
+// groups it was generated with.
+void SetSyntheticParts (const SyntheticSpec& iSpec, MultiLocusModel& ioModel)
+{
+	assert (ioModel.GetNumRows() == iSpec.mNumIsolates);
+	assert (ioModel.GetNumCols() == iSpec.mNumLoci);
+
+	vector<int> thePopSizes = SplitEvenly (iSpec.mNumIsolates, iSpec.mNumPops);
+	vector<int> theLinkSizes = SplitEvenly (iSpec.mNumLoci, iSpec.mNumLinkages);
+	ioModel.mPops.SetParts (thePopSizes);
+	ioModel.mLinkages.SetParts (theLinkSizes);
+}
+
+
+// *** END ***************************************************************/
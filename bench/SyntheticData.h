@@ -0,0 +1,81 @@
+/**************************************************************************
+SyntheticData.h - generating datasets of a given shape for benchmarking
+
+Credits:
+- By agent, 2026.
+- <mail://agent@local>
+
+About:
+- Writes haploid or diploid datasets in the input format of the program,
+  so that timings can be taken at any size without hunting for real data.
+- Isolates are split evenly into populations, each with its own allele
+  frequencies, so that theta has something to find. Loci are split evenly
+  into linkage groups; within a group, isolates largely copy one of a few
+  founder haplotypes of their population, so that the loci are in
+  disequilibrium & the index of association is not trivially zero.
+- For data like that of an outbreak, the isolates can be drawn from a few
+  profiles, so that many of them share a genotype. Alleles are dropped
+  after copying, so copies can still differ in their missing data.
+- The same spec (& seed) always gives the same dataset.
+
+**************************************************************************/
+
+#ifndef SYNTHETICDATA_H
+#define SYNTHETICDATA_H
+
+
+// *** INCLUDES
+
+#include "Sbl.h"
+#include "MultiLocusModel.h"
+
+#include <vector>
+#include <iostream>
+
+using std::vector;
+using std::ostream;
+using namespace sbl;
+
+
+// *** CONSTANTS & DEFINES
+
+struct SyntheticSpec
+{
+	ploidy_t	mPloidy;
+	UInt		mNumIsolates;
+	UInt		mNumLoci;
+	UInt		mNumAlleles;			// per locus, written as 1 to n
+	double	mMissingRate;			// chance of any one allele being "?"
+	UInt		mNumPops;
+	UInt		mNumLinkages;			// groups of linked loci
+	UInt		mNumProfiles;			// genotypes to copy, 0 for no copying
+	long		mSeed;
+
+	SyntheticSpec ()
+		: mPloidy (kPloidy_Haploid)
+		, mNumIsolates (100)
+		, mNumLoci (20)
+		, mNumAlleles (4)
+		, mMissingRate (0.02)
+		, mNumPops (2)
+		, mNumLinkages (4)
+		, mNumProfiles (0)
+		, mSeed (1)
+		{}
+};
+
+
+// *** FUNCTION DECLARATIONS *********************************************/
+
+void			CheckSyntheticSpec	(const SyntheticSpec& iSpec);
+vector<int>	SplitEvenly				(UInt iNumElements, UInt iNumParts);
+void			WriteSyntheticData	(const SyntheticSpec& iSpec,
+											ostream& ioOutStream);
+void			WriteSyntheticData	(const SyntheticSpec& iSpec,
+											const char* iPath);
+void			SetSyntheticParts		(const SyntheticSpec& iSpec,
+											MultiLocusModel& ioModel);
+
+
+#endif
+// *** END ***************************************************************/